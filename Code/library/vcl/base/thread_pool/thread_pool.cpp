@@ -0,0 +1,133 @@
+#include "thread_pool.hpp"
+
+namespace vcl
+{
+
+unsigned hardware_thread_count()
+{
+	unsigned const N = std::thread::hardware_concurrency();
+	return N==0 ? 1 : N;
+}
+
+thread_pool::thread_pool(unsigned number_of_threads)
+	:generation(0), stop(false)
+{
+	if(number_of_threads==0)
+		number_of_threads = hardware_thread_count();
+
+	for(unsigned k=0; k<number_of_threads; ++k)
+		queues.push_back(std::unique_ptr<task_queue>(new task_queue));
+
+	// queue 0 belongs to the thread calling run()
+	for(unsigned k=1; k<number_of_threads; ++k)
+		workers.push_back(std::thread(&thread_pool::worker, this, k));
+}
+
+thread_pool::~thread_pool()
+{
+	{
+		std::lock_guard<std::mutex> lock(state_access);
+		stop = true;
+	}
+	work_available.notify_all();
+	for(std::thread& w : workers)
+		w.join();
+}
+
+unsigned thread_pool::size() const
+{
+	return static_cast<unsigned>(queues.size());
+}
+
+void thread_pool::run(size_t number_of_tasks, std::function<void(size_t)> const& task)
+{
+	if(number_of_tasks==0)
+		return;
+
+	std::lock_guard<std::mutex> run_lock(run_access);
+
+	batch current;
+	current.task = &task;
+	current.remaining = number_of_tasks;
+
+	size_t const N_queue = queues.size();
+	for(size_t k_queue=0; k_queue<N_queue; ++k_queue) {
+		std::lock_guard<std::mutex> lock(queues[k_queue]->access);
+		for(size_t k=k_queue; k<number_of_tasks; k+=N_queue)
+			queues[k_queue]->tasks.push_back({&current, k});
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(state_access);
+		++generation;
+	}
+	work_available.notify_all();
+
+	while(execute_next_task(0)) {}
+
+	std::unique_lock<std::mutex> lock(state_access);
+	batch_done.wait(lock, [&current]{ return current.remaining==0; });
+}
+
+void thread_pool::worker(unsigned id)
+{
+	unsigned seen_generation = 0;
+	while(true)
+	{
+		{
+			std::unique_lock<std::mutex> lock(state_access);
+			work_available.wait(lock, [&]{ return stop || generation!=seen_generation; });
+			if(stop)
+				return;
+			seen_generation = generation;
+		}
+
+		while(execute_next_task(id)) {}
+	}
+}
+
+bool thread_pool::execute_next_task(unsigned id)
+{
+	std::pair<batch*, size_t> entry;
+	if(!pop_own_task(id, entry) && !steal_task(id, entry))
+		return false;
+
+	batch& current = *entry.first;
+	(*current.task)(entry.second);
+
+	if(--current.remaining==0) {
+		// lock so that the notification cannot be missed by run() between its check and its wait
+		std::lock_guard<std::mutex> lock(state_access);
+		batch_done.notify_all();
+	}
+	return true;
+}
+
+bool thread_pool::pop_own_task(unsigned id, std::pair<batch*, size_t>& entry)
+{
+	task_queue& queue = *queues[id];
+	std::lock_guard<std::mutex> lock(queue.access);
+	if(queue.tasks.empty())
+		return false;
+	entry = queue.tasks.back();
+	queue.tasks.pop_back();
+	return true;
+}
+
+bool thread_pool::steal_task(unsigned id, std::pair<batch*, size_t>& entry)
+{
+	size_t const N_queue = queues.size();
+	for(size_t k=1; k<N_queue; ++k)
+	{
+		task_queue& queue = *queues[(id+k)%N_queue];
+		std::lock_guard<std::mutex> lock(queue.access);
+		if(!queue.tasks.empty()) {
+			entry = queue.tasks.front();
+			queue.tasks.pop_front();
+			return true;
+		}
+	}
+	return false;
+}
+
+}
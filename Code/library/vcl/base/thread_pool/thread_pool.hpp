@@ -0,0 +1,100 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace vcl
+{
+
+/** Pool of worker threads executing batches of independent tasks
+ *
+ * run(N, task) calls task(k) for every k in [0,N) and returns once all of them are done.
+ * The tasks are dealt round-robin on one queue per thread. A thread takes the most recent task of its own queue,
+ * and once it is empty steals the oldest task of another queue, so that uneven tasks stay balanced.
+ * The calling thread takes part in the work: a pool of size 1 runs everything on the caller.
+ * Tasks must not throw, and run() is not reentrant (a task cannot call run() on the same pool).
+ */
+class thread_pool
+{
+public:
+	/** Pool using number_of_threads threads, caller included (0 = number of hardware threads) */
+	thread_pool(unsigned number_of_threads = 0);
+	~thread_pool();
+
+	thread_pool(thread_pool const&) = delete;
+	thread_pool& operator=(thread_pool const&) = delete;
+
+	/** Number of threads working on a batch, caller included */
+	unsigned size() const;
+
+	void run(size_t number_of_tasks, std::function<void(size_t)> const& task);
+
+private:
+	struct batch
+	{
+		std::function<void(size_t)> const* task;
+		std::atomic<size_t> remaining;
+	};
+
+	struct task_queue
+	{
+		std::mutex access;
+		std::deque<std::pair<batch*, size_t>> tasks;
+	};
+
+	void worker(unsigned id);
+	bool execute_next_task(unsigned id);
+	bool pop_own_task(unsigned id, std::pair<batch*, size_t>& entry);
+	bool steal_task(unsigned id, std::pair<batch*, size_t>& entry);
+
+	std::vector<std::unique_ptr<task_queue>> queues;
+	std::vector<std::thread> workers;
+
+	std::mutex run_access;     // one batch at a time
+	std::mutex state_access;
+	std::condition_variable work_available;
+	std::condition_variable batch_done;
+	unsigned generation;
+	bool stop;
+};
+
+/** Number of hardware threads, at least 1 */
+unsigned hardware_thread_count();
+
+/** Calls body(begin, end) on consecutive ranges covering [0,N), in parallel on the pool
+ *
+ * The ranges hold at least grain_size indices (and a multiple of 16, so that two ranges do not share the cache lines of a float or vec3 buffer),
+ * with at most 4 ranges per thread so that the work stealing balances them.
+ * Each range is walked in memory order by one thread: writing only to the elements of its own range is race-free.
+ * As run(), it cannot be called from a task of the same pool.
+ */
+template <typename Body>
+void parallel_for(thread_pool& pool, size_t N, size_t grain_size, Body const& body)
+{
+	if(N==0)
+		return;
+
+	size_t const alignment = 16;
+	size_t const max_ranges = 4*size_t(pool.size());
+	size_t range_size = std::max(grain_size, (N+max_ranges-1)/max_ranges);
+	range_size = (range_size+alignment-1)/alignment*alignment;
+
+	size_t const N_range = (N+range_size-1)/range_size;
+	if(N_range==1) {
+		body(size_t(0), N);
+		return;
+	}
+
+	pool.run(N_range, [&](size_t k) {
+		body(k*range_size, std::min(N, (k+1)*range_size));
+	});
+}
+
+}
@@ -3,4 +3,5 @@
 #include "opengl/opengl.hpp"
 #include "window/window.hpp"
 #include "drawable/drawable.hpp"
-#include "image/image.hpp"
\ No newline at end of file
+#include "image/image.hpp"
+#include "image/raster.hpp"
\ No newline at end of file
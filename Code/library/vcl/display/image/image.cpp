@@ -3,7 +3,6 @@
 #include "vcl/base/base.hpp"
 #include "vcl/files/files.hpp"
 #include "third_party/src/lodepng/lodepng.h"
-#include "vcl/display/opengl/opengl.hpp"
 
 namespace vcl
 {
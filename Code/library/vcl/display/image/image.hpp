@@ -1,6 +1,8 @@
 #pragma once
 
 #include "vcl/containers/containers.hpp"
+#include "vcl/base/thread_pool/thread_pool.hpp"
+#include "raster.hpp"
 
 namespace vcl
 {
@@ -19,6 +21,18 @@ namespace vcl
 	image_raw image_load_png(const std::string& filename, image_color_type color_type = image_color_type::rgba);
 	void image_save_png(const std::string& filename, const image_raw& im);
 
+	/** Compression of the multithreaded png writer
+	 * - store: no filter and no compression, the fastest
+	 * - fast: adaptive row filters and a short search of repeated sequences
+	 * - normal: adaptive row filters and a longer search with lazy matching, close to the size written by lodepng */
+	enum class png_compression {store, fast, normal};
+
+	/** Multithreaded png writer: the rows are filtered and deflated by independent blocks on the pool (8 bits per channel)
+	 * The file can be read back by image_load_png and any png decoder. */
+	void image_save_png(const std::string& filename, const image_raw& im, png_compression compression, thread_pool& pool);
+	void image_save_png(const std::string& filename, raster_view<uint8_t const> const& im, png_compression compression, thread_pool& pool);
+	void image_save_png(const std::string& filename, raster_view<pixel_rgb8 const> const& im, png_compression compression, thread_pool& pool);
+
 	void convert(image_raw const& in, grid_2D<vec3>& out);
 
 }
\ No newline at end of file
@@ -0,0 +1,628 @@
+#include "image.hpp"
+
+#include "vcl/base/base.hpp"
+#include "third_party/src/lodepng/lodepng.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <vector>
+
+// Multithreaded png writer
+//
+// The rows are filtered in parallel, then the filtered data is cut into blocks of about 128kB of whole rows deflated independently (as pigz does):
+// - each block may refer to the 32kB preceding it, which the decoder has already inflated,
+// - each block ends with a sync flush (empty stored block) so that the next one starts on a byte boundary, the last one with an empty final block,
+// - the Adler-32 of the blocks are combined into the one of the whole data.
+// Each block is written in its own IDAT chunk, whose CRC is computed by the thread which deflated it.
+
+namespace vcl
+{
+	namespace
+	{
+		size_t const block_size = 128*1024;
+		size_t const window_size = 32768;
+		unsigned const hash_bits = 15;
+		unsigned const min_match = 3;
+		unsigned const max_match = 258;
+		size_t const symbols_per_deflate_block = 16384;
+
+		unsigned const length_base[29] = {3,4,5,6,7,8,9,10,11,13,15,17,19,23,27,31,35,43,51,59,67,83,99,115,131,163,195,227,258};
+		unsigned const length_extra[29] = {0,0,0,0,0,0,0,0,1,1,1,1,2,2,2,2,3,3,3,3,4,4,4,4,5,5,5,5,0};
+		unsigned const distance_base[30] = {1,2,3,4,5,7,9,13,17,25,33,49,65,97,129,193,257,385,513,769,1025,1537,2049,3073,4097,6145,8193,12289,16385,24577};
+		unsigned const distance_extra[30] = {0,0,0,0,1,1,2,2,3,3,4,4,5,5,6,6,7,7,8,8,9,9,10,10,11,11,12,12,13,13};
+		unsigned const code_length_order[19] = {16,17,18,0,8,7,9,6,10,5,11,4,12,3,13,2,14,1,15};
+
+		// search effort of the compression levels: candidates visited per position, and lazy matching
+		struct match_effort
+		{
+			unsigned chain_length;
+			bool lazy;
+		};
+
+		match_effort effort_of(png_compression compression)
+		{
+			if(compression==png_compression::fast)
+				return {4, false};
+			return {64, true};
+		}
+
+
+		// bits packed from the least significant one as deflate requires, flushed by 4 bytes
+		struct bit_writer
+		{
+			std::vector<unsigned char>& out;
+			uint64_t buffer;
+			unsigned count;
+
+			bit_writer(std::vector<unsigned char>& out_arg) :out(out_arg), buffer(0), count(0) {}
+
+			// at most 16 bits at once
+			void write(uint32_t bits, unsigned number_of_bits)
+			{
+				buffer |= uint64_t(bits)<<count;
+				count += number_of_bits;
+				if(count>=32) {
+					out.push_back(static_cast<unsigned char>(buffer));
+					out.push_back(static_cast<unsigned char>(buffer>>8));
+					out.push_back(static_cast<unsigned char>(buffer>>16));
+					out.push_back(static_cast<unsigned char>(buffer>>24));
+					buffer >>= 32;
+					count -= 32;
+				}
+			}
+
+			// pads with zeros to a byte boundary and flushes everything
+			void align()
+			{
+				count = (count+7) & ~7u;
+				while(count>0) {
+					out.push_back(static_cast<unsigned char>(buffer));
+					buffer >>= 8;
+					count -= 8;
+				}
+			}
+		};
+
+
+		// huffman codes are sent from their most significant bit
+		uint32_t reverse_bits(uint32_t code, unsigned length)
+		{
+			uint32_t reversed = 0;
+			for(unsigned k=0; k<length; ++k)
+				reversed |= ((code>>k)&1u)<<(length-1-k);
+			return reversed;
+		}
+
+		struct huffman_code
+		{
+			std::vector<unsigned> lengths;
+			std::vector<uint32_t> codes; // bit reversed
+
+			// length limited code of the frequencies, at least two symbols get a code so that every decoder accepts it
+			void build(std::vector<unsigned> frequencies, unsigned max_length)
+			{
+				size_t used = 0;
+				for(unsigned f : frequencies)
+					used += f>0 ? 1 : 0;
+				for(size_t k=0; k<frequencies.size() && used<2; ++k)
+					if(frequencies[k]==0) { frequencies[k] = 1; ++used; }
+
+				lengths.assign(frequencies.size(), 0);
+				lodepng_huffman_code_lengths(lengths.data(), frequencies.data(), frequencies.size(), max_length);
+
+				// canonical codes, RFC 1951 section 3.2.2
+				std::vector<uint32_t> count(max_length+1, 0), next_code(max_length+2, 0);
+				for(unsigned l : lengths)
+					if(l>0) count[l]++;
+				uint32_t code = 0;
+				for(unsigned l=1; l<=max_length; ++l) {
+					code = (code + count[l-1])<<1;
+					next_code[l] = code;
+				}
+				codes.assign(lengths.size(), 0);
+				for(size_t k=0; k<lengths.size(); ++k)
+					if(lengths[k]>0)
+						codes[k] = reverse_bits(next_code[lengths[k]]++, lengths[k]);
+			}
+
+			void write(bit_writer& writer, size_t symbol) const
+			{
+				writer.write(codes[symbol], lengths[symbol]);
+			}
+		};
+
+
+		// literal (distance = 0) or match
+		struct lz_symbol
+		{
+			uint16_t literal_or_length;
+			uint16_t distance;
+		};
+
+		unsigned length_symbol(unsigned length)
+		{
+			static std::vector<unsigned char> const table = []() {
+				std::vector<unsigned char> t(max_match+1, 0);
+				for(unsigned l=min_match; l<=max_match; ++l)
+					t[l] = static_cast<unsigned char>(std::upper_bound(length_base, length_base+29, l) - length_base - 1);
+				return t;
+			}();
+			return table[length];
+		}
+
+		// distances up to 256 are looked up directly, the larger ones by their value divided by 128
+		unsigned distance_symbol(unsigned distance)
+		{
+			static std::vector<unsigned char> const table = []() {
+				std::vector<unsigned char> t(512, 0);
+				for(unsigned d=1; d<=256; ++d)
+					t[d-1] = static_cast<unsigned char>(std::upper_bound(distance_base, distance_base+30, d) - distance_base - 1);
+				for(unsigned d=257; d<=window_size; d+=128)
+					t[256+((d-1)>>7)] = static_cast<unsigned char>(std::upper_bound(distance_base, distance_base+30, d) - distance_base - 1);
+				return t;
+			}();
+			return distance<=256 ? table[distance-1] : table[256+((distance-1)>>7)];
+		}
+
+
+		uint32_t hash3(unsigned char const* p)
+		{
+			uint32_t const v = uint32_t(p[0]) | (uint32_t(p[1])<<8) | (uint32_t(p[2])<<16);
+			return (v*2654435761u)>>(32-hash_bits);
+		}
+
+		// greedy (or lazy) LZ77 parse of data[begin,end), the matches may start in the window [window_begin, begin)
+		std::vector<lz_symbol> lz77(unsigned char const* data, size_t window_begin, size_t begin, size_t end, match_effort effort)
+		{
+			std::vector<int32_t> head(size_t(1)<<hash_bits, -1);
+			std::vector<int32_t> previous(end-window_begin, -1); // previous position of the same hash, relative to window_begin
+
+			auto insert = [&](size_t p) {
+				if(p+min_match>end) return;
+				uint32_t const h = hash3(data+p);
+				previous[p-window_begin] = head[h];
+				head[h] = int32_t(p-window_begin);
+			};
+
+			auto longest_match = [&](size_t p, unsigned& best_distance) {
+				unsigned best_length = 0;
+				if(p+min_match>end) return best_length;
+				unsigned const limit = unsigned(std::min<size_t>(max_match, end-p));
+				int32_t candidate = head[hash3(data+p)];
+				for(unsigned chain=0; chain<effort.chain_length && candidate>=0; ++chain)
+				{
+					size_t const c = window_begin + size_t(candidate);
+					if(p-c>window_size) break;
+					if(data[c+best_length]==data[p+best_length]) {
+						unsigned length = 0;
+						while(length<limit && data[c+length]==data[p+length]) ++length;
+						if(length>best_length) {
+							best_length = length;
+							best_distance = unsigned(p-c);
+							if(length==limit) break;
+						}
+					}
+					candidate = previous[c-window_begin];
+				}
+				return best_length>=min_match ? best_length : 0u;
+			};
+
+			for(size_t p=window_begin; p<begin; ++p)
+				insert(p);
+
+			std::vector<lz_symbol> symbols;
+			symbols.reserve((end-begin)/2);
+
+			size_t p = begin;
+			while(p<end)
+			{
+				unsigned distance = 0;
+				unsigned length = longest_match(p, distance);
+
+				if(length>0 && effort.lazy && p+1<end) {
+					// a longer match at the next position is worth a literal
+					insert(p);
+					unsigned next_distance = 0;
+					unsigned const next_length = longest_match(p+1, next_distance);
+					if(next_length>length) {
+						symbols.push_back({uint16_t(data[p]), 0});
+						++p;
+						length = next_length;
+						distance = next_distance;
+					}
+					else {
+						symbols.push_back({uint16_t(length), uint16_t(distance)});
+						for(size_t k=p+1; k<p+length; ++k) insert(k);
+						p += length;
+						continue;
+					}
+				}
+
+				if(length>0) {
+					symbols.push_back({uint16_t(length), uint16_t(distance)});
+					for(size_t k=p; k<p+length; ++k) insert(k);
+					p += length;
+				}
+				else {
+					symbols.push_back({uint16_t(data[p]), 0});
+					insert(p);
+					++p;
+				}
+			}
+
+			return symbols;
+		}
+
+
+		// one deflate block with dynamic huffman codes, never final
+		void write_dynamic_block(bit_writer& writer, lz_symbol const* symbols, size_t number_of_symbols)
+		{
+			std::vector<unsigned> literal_frequencies(286, 0), distance_frequencies(30, 0);
+			for(size_t k=0; k<number_of_symbols; ++k) {
+				if(symbols[k].distance==0)
+					literal_frequencies[symbols[k].literal_or_length]++;
+				else {
+					literal_frequencies[257+length_symbol(symbols[k].literal_or_length)]++;
+					distance_frequencies[distance_symbol(symbols[k].distance)]++;
+				}
+			}
+			literal_frequencies[256] = 1;
+
+			huffman_code literals, distances;
+			literals.build(literal_frequencies, 15);
+			distances.build(distance_frequencies, 15);
+
+			unsigned number_of_literal_codes = 286;
+			while(number_of_literal_codes>257 && literals.lengths[number_of_literal_codes-1]==0) --number_of_literal_codes;
+			unsigned number_of_distance_codes = 30;
+			while(number_of_distance_codes>1 && distances.lengths[number_of_distance_codes-1]==0) --number_of_distance_codes;
+
+			// run length coding of the code lengths: 16 repeats the previous length 3-6 times, 17 and 18 repeat zero 3-10 and 11-138 times
+			std::vector<unsigned> all_lengths(literals.lengths.begin(), literals.lengths.begin()+number_of_literal_codes);
+			all_lengths.insert(all_lengths.end(), distances.lengths.begin(), distances.lengths.begin()+number_of_distance_codes);
+
+			std::vector<std::pair<unsigned,unsigned>> runs; // (symbol, extra bits value)
+			for(size_t k=0; k<all_lengths.size();)
+			{
+				unsigned const l = all_lengths[k];
+				size_t run = 1;
+				while(k+run<all_lengths.size() && all_lengths[k+run]==l) ++run;
+
+				if(l==0 && run>=3) {
+					size_t const r = std::min<size_t>(run, 138);
+					if(r>=11) runs.push_back({18, unsigned(r-11)});
+					else runs.push_back({17, unsigned(r-3)});
+					k += r;
+				}
+				else if(l!=0 && run>=4) {
+					runs.push_back({l, 0});
+					size_t const r = std::min<size_t>(run-1, 6);
+					runs.push_back({16, unsigned(r-3)});
+					k += 1+r;
+				}
+				else {
+					runs.push_back({l, 0});
+					++k;
+				}
+			}
+
+			std::vector<unsigned> code_length_frequencies(19, 0);
+			for(auto const& r : runs)
+				code_length_frequencies[r.first]++;
+			huffman_code code_lengths;
+			code_lengths.build(code_length_frequencies, 7);
+
+			unsigned number_of_code_length_codes = 19;
+			while(number_of_code_length_codes>4 && code_lengths.lengths[code_length_order[number_of_code_length_codes-1]]==0) --number_of_code_length_codes;
+
+			writer.write(0, 1); // not final
+			writer.write(2, 2); // dynamic huffman codes
+			writer.write(number_of_literal_codes-257, 5);
+			writer.write(number_of_distance_codes-1, 5);
+			writer.write(number_of_code_length_codes-4, 4);
+			for(unsigned k=0; k<number_of_code_length_codes; ++k)
+				writer.write(code_lengths.lengths[code_length_order[k]], 3);
+			for(auto const& r : runs) {
+				code_lengths.write(writer, r.first);
+				if(r.first==16) writer.write(r.second, 2);
+				if(r.first==17) writer.write(r.second, 3);
+				if(r.first==18) writer.write(r.second, 7);
+			}
+
+			for(size_t k=0; k<number_of_symbols; ++k)
+			{
+				lz_symbol const& s = symbols[k];
+				if(s.distance==0) {
+					literals.write(writer, s.literal_or_length);
+					continue;
+				}
+				unsigned const l = length_symbol(s.literal_or_length);
+				literals.write(writer, 257+l);
+				writer.write(s.literal_or_length-length_base[l], length_extra[l]);
+				unsigned const d = distance_symbol(s.distance);
+				distances.write(writer, d);
+				writer.write(s.distance-distance_base[d], distance_extra[d]);
+			}
+			literals.write(writer, 256);
+		}
+
+		// stored blocks of at most 65535 bytes, never final
+		void write_stored_blocks(bit_writer& writer, unsigned char const* data, size_t size)
+		{
+			for(size_t offset=0; offset<size; offset+=65535)
+			{
+				size_t const length = std::min<size_t>(65535, size-offset);
+				writer.write(0, 1);
+				writer.write(0, 2);
+				writer.align();
+				writer.write(uint32_t(length), 16);
+				writer.write(uint32_t(~length & 0xffff), 16);
+				writer.out.insert(writer.out.end(), data+offset, data+offset+length);
+			}
+		}
+
+		// deflates data[begin,end), then ends on a byte boundary with a sync flush, or with an empty final block for the last one
+		void deflate_block(unsigned char const* data, size_t begin, size_t end, bool last, png_compression compression, std::vector<unsigned char>& out)
+		{
+			bit_writer writer(out);
+
+			if(compression==png_compression::store)
+				write_stored_blocks(writer, data+begin, end-begin);
+			else {
+				size_t const window_begin = begin>window_size ? begin-window_size : 0;
+				std::vector<lz_symbol> const symbols = lz77(data, window_begin, begin, end, effort_of(compression));
+				for(size_t k=0; k<symbols.size(); k+=symbols_per_deflate_block)
+					write_dynamic_block(writer, symbols.data()+k, std::min(symbols_per_deflate_block, symbols.size()-k));
+			}
+
+			if(last) {
+				writer.write(1, 1); // final
+				writer.write(1, 2); // fixed huffman codes
+				writer.write(0, 7); // end of block
+				writer.align();
+			}
+			else {
+				writer.write(0, 3); // empty stored block
+				writer.align();
+				writer.write(0x0000, 16);
+				writer.write(0xffff, 16);
+				writer.align();
+			}
+		}
+
+
+		uint32_t adler32(unsigned char const* data, size_t size)
+		{
+			uint32_t a = 1, b = 0;
+			while(size>0) {
+				size_t const n = std::min<size_t>(size, 5552); // largest run without overflow before the modulo
+				for(size_t k=0; k<n; ++k) {
+					a += data[k];
+					b += a;
+				}
+				a %= 65521;
+				b %= 65521;
+				data += n;
+				size -= n;
+			}
+			return (b<<16) | a;
+		}
+
+		// Adler-32 of the concatenation of two data, the second one being of the given size (as adler32_combine of zlib)
+		uint32_t adler32_combine(uint32_t adler1, uint32_t adler2, size_t size2)
+		{
+			uint32_t const base = 65521;
+			uint32_t const remainder = uint32_t(size2%base);
+			uint32_t sum1 = adler1 & 0xffff;
+			uint32_t sum2 = uint32_t((uint64_t(remainder)*sum1)%base);
+			sum1 += (adler2 & 0xffff) + base - 1;
+			sum2 += ((adler1>>16) & 0xffff) + ((adler2>>16) & 0xffff) + base - remainder;
+			if(sum1>=base) sum1 -= base;
+			if(sum1>=base) sum1 -= base;
+			if(sum2>=(base<<1)) sum2 -= (base<<1);
+			if(sum2>=base) sum2 -= base;
+			return sum1 | (sum2<<16);
+		}
+
+		uint32_t crc32(unsigned char const* data, size_t size, uint32_t crc = 0)
+		{
+			static std::vector<uint32_t> const table = []() {
+				std::vector<uint32_t> t(256);
+				for(uint32_t n=0; n<256; ++n) {
+					uint32_t c = n;
+					for(int k=0; k<8; ++k)
+						c = (c&1) ? 0xedb88320u^(c>>1) : c>>1;
+					t[n] = c;
+				}
+				return t;
+			}();
+
+			crc = ~crc;
+			for(size_t k=0; k<size; ++k)
+				crc = table[(crc^data[k]) & 0xff]^(crc>>8);
+			return ~crc;
+		}
+
+
+		void push_u32(std::vector<unsigned char>& out, uint32_t value)
+		{
+			out.push_back(static_cast<unsigned char>(value>>24));
+			out.push_back(static_cast<unsigned char>(value>>16));
+			out.push_back(static_cast<unsigned char>(value>>8));
+			out.push_back(static_cast<unsigned char>(value));
+		}
+
+		// length, type, data, CRC of type and data
+		std::vector<unsigned char> png_chunk(char const* type, std::vector<unsigned char> const& data)
+		{
+			std::vector<unsigned char> chunk;
+			chunk.reserve(data.size()+12);
+			push_u32(chunk, uint32_t(data.size()));
+			chunk.insert(chunk.end(), type, type+4);
+			chunk.insert(chunk.end(), data.begin(), data.end());
+			push_u32(chunk, crc32(chunk.data()+4, data.size()+4));
+			return chunk;
+		}
+
+
+		// written without branches, the choice depending on the data
+		inline int paeth(int a, int b, int c)
+		{
+			int const pa = std::abs(b-c), pb = std::abs(a-c), pc = std::abs(a+b-2*c);
+			int const b_or_c = pb<=pc ? b : c;
+			return (pa<=pb && pa<=pc) ? a : b_or_c;
+		}
+
+
+		// filters the row (preceded by previous, nullptr for the first one) into out, filter type first
+		// the filter of smallest sum of absolute values (as signed bytes) is chosen, no filter for the store level
+		void filter_row(unsigned char const* row, unsigned char const* previous, size_t row_size, unsigned bytes_per_pixel, bool adaptive,
+		                std::vector<unsigned char>& candidate, unsigned char* out)
+		{
+			out[0] = 0;
+			std::copy(row, row+row_size, out+1);
+			if(!adaptive)
+				return;
+
+			auto absolute_sum = [](unsigned char const* values, size_t size) {
+				size_t sum = 0;
+				for(size_t k=0; k<size; ++k)
+					sum += values[k]<128 ? values[k] : 256-values[k];
+				return sum;
+			};
+
+			std::vector<unsigned char> const zeros(previous ? 0 : row_size, 0);
+			unsigned char const* up = previous ? previous : zeros.data();
+			size_t const n = std::min<size_t>(bytes_per_pixel, row_size);
+
+			size_t best_sum = absolute_sum(out+1, row_size);
+			candidate.resize(row_size);
+			unsigned char* const c = candidate.data();
+			for(unsigned char type=1; type<5; ++type)
+			{
+				// the first pixel has no left neighbour
+				switch(type) {
+				case 1:
+					std::copy(row, row+n, c);
+					for(size_t k=n; k<row_size; ++k) c[k] = static_cast<unsigned char>(row[k]-row[k-n]);
+					break;
+				case 2:
+					for(size_t k=0; k<row_size; ++k) c[k] = static_cast<unsigned char>(row[k]-up[k]);
+					break;
+				case 3:
+					for(size_t k=0; k<n; ++k) c[k] = static_cast<unsigned char>(row[k]-up[k]/2);
+					for(size_t k=n; k<row_size; ++k) c[k] = static_cast<unsigned char>(row[k]-(row[k-n]+up[k])/2);
+					break;
+				default:
+					for(size_t k=0; k<n; ++k) c[k] = static_cast<unsigned char>(row[k]-up[k]);
+					for(size_t k=n; k<row_size; ++k) c[k] = static_cast<unsigned char>(row[k]-paeth(row[k-n], up[k], up[k-n]));
+				}
+
+				size_t const sum = absolute_sum(c, row_size);
+				if(sum<best_sum) {
+					best_sum = sum;
+					out[0] = type;
+					std::copy(c, c+row_size, out+1);
+				}
+			}
+		}
+
+
+		// row(y) points to the width*channels bytes of the row y
+		template <typename Row>
+		void png_encode(std::string const& filename, unsigned int width, unsigned int height, unsigned int channels, Row const& row,
+		                png_compression compression, thread_pool& pool)
+		{
+			unsigned char const color_types[5] = {0, 0, 4, 2, 6}; // grey, grey and alpha, rgb, rgba
+			size_t const row_size = size_t(width)*channels;
+			size_t const filtered_row_size = row_size+1;
+
+			// filtered rows, in parallel by blocks of rows
+			std::vector<unsigned char> filtered(filtered_row_size*height);
+			size_t const rows_per_block = std::max<size_t>(1, block_size/filtered_row_size);
+			size_t const number_of_blocks = (height+rows_per_block-1)/rows_per_block;
+			pool.run(number_of_blocks, [&](size_t b) {
+				size_t const y_end = std::min<size_t>(height, (b+1)*rows_per_block);
+				std::vector<unsigned char> candidate;
+				for(size_t y=b*rows_per_block; y<y_end; ++y)
+					filter_row(row(unsigned(y)), y>0 ? row(unsigned(y-1)) : nullptr, row_size, channels, compression!=png_compression::store, candidate, filtered.data()+y*filtered_row_size);
+			});
+
+			// deflated blocks of rows, each in its own IDAT chunk
+			std::vector<std::vector<unsigned char>> chunks(number_of_blocks);
+			std::vector<uint32_t> adlers(number_of_blocks);
+			pool.run(number_of_blocks, [&](size_t b) {
+				size_t const begin = b*rows_per_block*filtered_row_size;
+				size_t const end = std::min<size_t>(height, (b+1)*rows_per_block)*filtered_row_size;
+				std::vector<unsigned char> deflated;
+				if(b==0) {
+					// zlib header: deflate with a 32kB window, FCHECK making it a multiple of 31
+					unsigned char const level = compression==png_compression::store ? 0 : compression==png_compression::fast ? 1 : 2;
+					unsigned const header = (0x78u<<8) | (level<<6);
+					deflated.push_back(0x78);
+					deflated.push_back(static_cast<unsigned char>((level<<6) + (31 - header%31)%31));
+				}
+				deflate_block(filtered.data(), begin, end, b+1==number_of_blocks, compression, deflated);
+				adlers[b] = adler32(filtered.data()+begin, end-begin);
+				chunks[b] = png_chunk("IDAT", deflated);
+			});
+
+			uint32_t adler = adlers.empty() ? 1u : adlers[0];
+			for(size_t b=1; b<number_of_blocks; ++b) {
+				size_t const end = std::min<size_t>(height, (b+1)*rows_per_block)*filtered_row_size;
+				adler = adler32_combine(adler, adlers[b], end-b*rows_per_block*filtered_row_size);
+			}
+
+			std::vector<unsigned char> header;
+			push_u32(header, width);
+			push_u32(header, height);
+			header.push_back(8);
+			header.push_back(color_types[channels]);
+			header.push_back(0);
+			header.push_back(0);
+			header.push_back(0);
+
+			std::vector<unsigned char> checksum;
+			push_u32(checksum, adler);
+
+			std::ofstream stream(filename, std::ios::binary);
+			if(!stream.is_open())
+				error_vcl("Cannot write the png file "+filename);
+
+			unsigned char const signature[8] = {137, 80, 78, 71, 13, 10, 26, 10};
+			stream.write(reinterpret_cast<char const*>(signature), 8);
+			auto write_chunk = [&](std::vector<unsigned char> const& chunk) {
+				stream.write(reinterpret_cast<char const*>(chunk.data()), std::streamsize(chunk.size()));
+			};
+			write_chunk(png_chunk("IHDR", header));
+			for(std::vector<unsigned char> const& chunk : chunks)
+				write_chunk(chunk);
+			write_chunk(png_chunk("IDAT", checksum));
+			write_chunk(png_chunk("IEND", std::vector<unsigned char>()));
+
+			stream.close();
+			if(!stream)
+				error_vcl("Error while writing the png file "+filename);
+		}
+	}
+
+
+	void image_save_png(const std::string& filename, const image_raw& im, png_compression compression, thread_pool& pool)
+	{
+		unsigned int const channels = im.color_type==image_color_type::rgba ? 4 : 3;
+		size_t const row_size = size_t(im.width)*channels;
+		png_encode(filename, im.width, im.height, channels, [&](unsigned int y) { return im.data.data.data()+y*row_size; }, compression, pool);
+	}
+
+	void image_save_png(const std::string& filename, raster_view<uint8_t const> const& im, png_compression compression, thread_pool& pool)
+	{
+		png_encode(filename, im.width, im.height, 1, [&](unsigned int y) { return im.row(y); }, compression, pool);
+	}
+
+	void image_save_png(const std::string& filename, raster_view<pixel_rgb8 const> const& im, png_compression compression, thread_pool& pool)
+	{
+		png_encode(filename, im.width, im.height, 3, [&](unsigned int y) { return reinterpret_cast<unsigned char const*>(im.row(y)); }, compression, pool);
+	}
+}
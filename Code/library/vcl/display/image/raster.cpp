@@ -0,0 +1,92 @@
+#include "raster.hpp"
+
+#include "vcl/base/base.hpp"
+
+#include <fstream>
+#include <vector>
+
+namespace vcl
+{
+	static_assert(sizeof(pixel_rgb8)==3, "pixel_rgb8 has to be 3 consecutive bytes to be written without conversion");
+
+	static std::ofstream open_image_file(std::string const& filename)
+	{
+		std::ofstream stream(filename, std::ios::binary);
+		if(!stream.is_open())
+			error_vcl("Cannot write the image file "+filename);
+		return stream;
+	}
+
+	static void close_image_file(std::ofstream& stream, std::string const& filename)
+	{
+		stream.close();
+		if(!stream)
+			error_vcl("Error while writing the image file "+filename);
+	}
+
+	// Writes the pixels unchanged, with one call per row or one call for a contiguous image
+	template <typename T>
+	static void write_pixels(std::ofstream& stream, raster_view<T const> const& im)
+	{
+		if(im.contiguous()) {
+			stream.write(reinterpret_cast<char const*>(im.data), std::streamsize(sizeof(T)*im.width*im.height));
+			return;
+		}
+		for(unsigned int y=0; y<im.height; ++y)
+			stream.write(reinterpret_cast<char const*>(im.row(y)), std::streamsize(sizeof(T)*im.width));
+	}
+
+	static bool little_endian()
+	{
+		uint16_t const one = 1;
+		return *reinterpret_cast<uint8_t const*>(&one)==1;
+	}
+
+	void image_save_pgm(std::string const& filename, raster_view<uint8_t const> const& im)
+	{
+		std::ofstream stream = open_image_file(filename);
+		stream<<"P5\n"<<im.width<<" "<<im.height<<"\n255\n";
+		write_pixels(stream, im);
+		close_image_file(stream, filename);
+	}
+
+	void image_save_pgm(std::string const& filename, raster_view<uint16_t const> const& im)
+	{
+		std::ofstream stream = open_image_file(filename);
+		stream<<"P5\n"<<im.width<<" "<<im.height<<"\n65535\n";
+
+		// most significant byte first
+		std::vector<uint8_t> bytes(2*size_t(im.width));
+		for(unsigned int y=0; y<im.height; ++y)
+		{
+			uint16_t const* row = im.row(y);
+			for(unsigned int x=0; x<im.width; ++x) {
+				bytes[2*x+0] = uint8_t(row[x]>>8);
+				bytes[2*x+1] = uint8_t(row[x]&0xff);
+			}
+			stream.write(reinterpret_cast<char const*>(bytes.data()), std::streamsize(bytes.size()));
+		}
+
+		close_image_file(stream, filename);
+	}
+
+	void image_save_ppm(std::string const& filename, raster_view<pixel_rgb8 const> const& im)
+	{
+		std::ofstream stream = open_image_file(filename);
+		stream<<"P6\n"<<im.width<<" "<<im.height<<"\n255\n";
+		write_pixels(stream, im);
+		close_image_file(stream, filename);
+	}
+
+	void image_save_pfm(std::string const& filename, raster_view<float const> const& im)
+	{
+		std::ofstream stream = open_image_file(filename);
+
+		// a negative scale stands for little endian floats
+		stream<<"Pf\n"<<im.width<<" "<<im.height<<"\n"<<(little_endian() ? "-1.0" : "1.0")<<"\n";
+		for(unsigned int y=im.height; y>0; --y)
+			stream.write(reinterpret_cast<char const*>(im.row(y-1)), std::streamsize(sizeof(float)*im.width));
+
+		close_image_file(stream, filename);
+	}
+}
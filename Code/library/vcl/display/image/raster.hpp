@@ -0,0 +1,188 @@
+#pragma once
+
+#include "vcl/containers/containers.hpp"
+
+#include <cstdint>
+#include <string>
+
+namespace vcl
+{
+	/** 8 bits RGB pixel, stored as 3 consecutive bytes */
+	struct pixel_rgb8
+	{
+		uint8_t r, g, b;
+	};
+
+	/** Non owning access to width x height pixels, the pixel (x,y) being at data[x + stride*y]
+	 * A view of a part of a raster (or of any buffer of pixels) is handed to the writers without copying it.
+	 * raster_view<T> converts to raster_view<T const>. */
+	template <typename T>
+	struct raster_view
+	{
+		raster_view();
+		raster_view(T* data_arg, unsigned int width_arg, unsigned int height_arg, size_t stride_arg);
+		raster_view(T* data_arg, unsigned int width_arg, unsigned int height_arg);
+
+		T& operator()(unsigned int x, unsigned int y) const;
+		T* row(unsigned int y) const;
+
+		/** View of the width x height pixels starting at (x,y) */
+		raster_view<T> sub_view(unsigned int x, unsigned int y, unsigned int width_arg, unsigned int height_arg) const;
+
+		/** The rows follow each other without gap */
+		bool contiguous() const;
+
+		operator raster_view<T const>() const;
+
+		T* data;
+		unsigned int width;
+		unsigned int height;
+		size_t stride;
+	};
+
+	/** Image of width x height pixels of type T stored row after row: the pixel (x,y) is data[x + width*y] */
+	template <typename T>
+	struct raster
+	{
+		raster();
+		raster(unsigned int width_arg, unsigned int height_arg);
+		raster(unsigned int width_arg, unsigned int height_arg, T const& value);
+
+		void resize(unsigned int width_arg, unsigned int height_arg);
+
+		T const& operator()(unsigned int x, unsigned int y) const;
+		T& operator()(unsigned int x, unsigned int y);
+
+		raster_view<T> view();
+		raster_view<T const> view() const;
+		operator raster_view<T const>() const;
+
+		unsigned int width;
+		unsigned int height;
+		buffer<T> data;
+	};
+
+	using raster_grey8 = raster<uint8_t>;
+	using raster_rgb8 = raster<pixel_rgb8>;
+	using raster_grey16 = raster<uint16_t>;
+	using raster_float = raster<float>;
+
+	/** Binary writers, the rows are written with one call each (one call for the whole image if it is contiguous)
+	 * - 8 bits grey: PGM (P5) with maxval 255
+	 * - 16 bits grey: PGM (P5) with maxval 65535, big endian as required by the format, for lossless heightmaps
+	 * - 8 bits RGB: PPM (P6)
+	 * - 32 bits float grey: PFM (Pf), rows from bottom to top as required by the format, values written unchanged */
+	void image_save_pgm(std::string const& filename, raster_view<uint8_t const> const& im);
+	void image_save_pgm(std::string const& filename, raster_view<uint16_t const> const& im);
+	void image_save_ppm(std::string const& filename, raster_view<pixel_rgb8 const> const& im);
+	void image_save_pfm(std::string const& filename, raster_view<float const> const& im);
+}
+
+
+namespace vcl
+{
+	template <typename T>
+	raster_view<T>::raster_view()
+		:data(nullptr), width(0), height(0), stride(0)
+	{}
+
+	template <typename T>
+	raster_view<T>::raster_view(T* data_arg, unsigned int width_arg, unsigned int height_arg, size_t stride_arg)
+		:data(data_arg), width(width_arg), height(height_arg), stride(stride_arg)
+	{}
+
+	template <typename T>
+	raster_view<T>::raster_view(T* data_arg, unsigned int width_arg, unsigned int height_arg)
+		:data(data_arg), width(width_arg), height(height_arg), stride(width_arg)
+	{}
+
+	template <typename T>
+	T& raster_view<T>::operator()(unsigned int x, unsigned int y) const
+	{
+		assert_vcl(x<width && y<height, "Pixel ("+str(x)+","+str(y)+") out of a raster of size "+str(width)+"x"+str(height));
+		return data[x + stride*y];
+	}
+
+	template <typename T>
+	T* raster_view<T>::row(unsigned int y) const
+	{
+		return data + stride*y;
+	}
+
+	template <typename T>
+	raster_view<T> raster_view<T>::sub_view(unsigned int x, unsigned int y, unsigned int width_arg, unsigned int height_arg) const
+	{
+		assert_vcl(x+width_arg<=width && y+height_arg<=height, "Sub view out of the raster");
+		return raster_view<T>(data + x + stride*y, width_arg, height_arg, stride);
+	}
+
+	template <typename T>
+	bool raster_view<T>::contiguous() const
+	{
+		return stride==width || height<=1;
+	}
+
+	template <typename T>
+	raster_view<T>::operator raster_view<T const>() const
+	{
+		return raster_view<T const>(data, width, height, stride);
+	}
+
+
+	template <typename T>
+	raster<T>::raster()
+		:width(0), height(0), data()
+	{}
+
+	template <typename T>
+	raster<T>::raster(unsigned int width_arg, unsigned int height_arg)
+		:width(width_arg), height(height_arg), data(size_t(width_arg)*size_t(height_arg))
+	{}
+
+	template <typename T>
+	raster<T>::raster(unsigned int width_arg, unsigned int height_arg, T const& value)
+		:width(width_arg), height(height_arg), data(size_t(width_arg)*size_t(height_arg))
+	{
+		data.fill(value);
+	}
+
+	template <typename T>
+	void raster<T>::resize(unsigned int width_arg, unsigned int height_arg)
+	{
+		width = width_arg;
+		height = height_arg;
+		data.resize(size_t(width_arg)*size_t(height_arg));
+	}
+
+	template <typename T>
+	T const& raster<T>::operator()(unsigned int x, unsigned int y) const
+	{
+		assert_vcl(x<width && y<height, "Pixel ("+str(x)+","+str(y)+") out of a raster of size "+str(width)+"x"+str(height));
+		return data.data[x + size_t(width)*y];
+	}
+
+	template <typename T>
+	T& raster<T>::operator()(unsigned int x, unsigned int y)
+	{
+		assert_vcl(x<width && y<height, "Pixel ("+str(x)+","+str(y)+") out of a raster of size "+str(width)+"x"+str(height));
+		return data.data[x + size_t(width)*y];
+	}
+
+	template <typename T>
+	raster_view<T> raster<T>::view()
+	{
+		return raster_view<T>(data.data.data(), width, height);
+	}
+
+	template <typename T>
+	raster_view<T const> raster<T>::view() const
+	{
+		return raster_view<T const>(data.data.data(), width, height);
+	}
+
+	template <typename T>
+	raster<T>::operator raster_view<T const>() const
+	{
+		return view();
+	}
+}
@@ -0,0 +1,273 @@
+#include "fft.hpp"
+
+#include "vcl/base/base.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+namespace vcl
+{
+
+fft_plan::fft_plan()
+	:N(0)
+{}
+
+fft_plan::fft_plan(size_t N_arg)
+	:N(N_arg), twiddles(N_arg), inverse_twiddles(N_arg)
+{
+	assert_vcl(N>0, "FFT of an empty sequence");
+
+	// radix 4 first, then 2, 3, 5 and the remaining primes
+	size_t n = N;
+	while(n%4==0) { radices.push_back(4); n /= 4; }
+	while(n%2==0) { radices.push_back(2); n /= 2; }
+	for(size_t p=3; p*p<=n; p+=2)
+		while(n%p==0) { radices.push_back(p); n /= p; }
+	if(n>1 || radices.empty())
+		radices.push_back(n);
+
+	// twiddle factors computed in double precision
+	double const two_pi = 6.283185307179586;
+	for(size_t k=0; k<N; ++k)
+	{
+		double const angle = two_pi*double(k)/double(N);
+		twiddles[k] = std::complex<float>(float(std::cos(angle)), float(-std::sin(angle)));
+		inverse_twiddles[k] = std::conj(twiddles[k]);
+	}
+}
+
+size_t fft_plan::size() const
+{
+	return N;
+}
+
+void fft_plan::transform(std::complex<float>* data, std::complex<float>* workspace, bool inverse) const
+{
+	if(N<=1)
+		return;
+	std::copy(data, data+N, workspace);
+	transform_recursive(data, workspace, 1, 0, inverse);
+}
+
+// decimation in time: the p sub-sequences input[q + p.k] are transformed into output[q.m .. (q+1).m-1], then combined
+void fft_plan::transform_recursive(std::complex<float>* output, std::complex<float> const* input, size_t stride, size_t factor, bool inverse) const
+{
+	size_t const p = radices[factor];
+	size_t const m = N/(stride*p);
+
+	if(m==1)
+	{
+		for(size_t q=0; q<p; ++q)
+			output[q] = input[q*stride];
+	}
+	else
+	{
+		for(size_t q=0; q<p; ++q)
+			transform_recursive(output+q*m, input+q*stride, stride*p, factor+1, inverse);
+	}
+
+	butterfly(output, stride, p, m, inverse);
+}
+
+void fft_plan::butterfly(std::complex<float>* output, size_t stride, size_t p, size_t m, bool inverse) const
+{
+	std::complex<float> const* tw = inverse ? inverse_twiddles.data() : twiddles.data();
+
+	if(p==2)
+	{
+		for(size_t k=0; k<m; ++k)
+		{
+			std::complex<float> const t = output[k+m]*tw[k*stride];
+			output[k+m] = output[k]-t;
+			output[k] += t;
+		}
+	}
+	else if(p==4)
+	{
+		for(size_t k=0; k<m; ++k)
+		{
+			std::complex<float> const a0 = output[k];
+			std::complex<float> const a1 = output[k+m]*tw[k*stride];
+			std::complex<float> const a2 = output[k+2*m]*tw[2*k*stride];
+			std::complex<float> const a3 = output[k+3*m]*tw[3*k*stride];
+
+			std::complex<float> const s0 = a0+a2;
+			std::complex<float> const s1 = a0-a2;
+			std::complex<float> const s2 = a1+a3;
+			std::complex<float> const d = a1-a3;
+			// -i.d for the forward transform, +i.d for the inverse one
+			std::complex<float> const s3 = inverse ? std::complex<float>(-d.imag(), d.real()) : std::complex<float>(d.imag(), -d.real());
+
+			output[k]     = s0+s2;
+			output[k+m]   = s1+s3;
+			output[k+2*m] = s0-s2;
+			output[k+3*m] = s1-s3;
+		}
+	}
+	else if(p==3)
+	{
+		float const sin_third = tw[N/3].imag(); // -sqrt(3)/2 forward, +sqrt(3)/2 inverse
+		for(size_t k=0; k<m; ++k)
+		{
+			std::complex<float> const a0 = output[k];
+			std::complex<float> const a1 = output[k+m]*tw[k*stride];
+			std::complex<float> const a2 = output[k+2*m]*tw[2*k*stride];
+
+			std::complex<float> const s = a1+a2;
+			std::complex<float> const d = a1-a2;
+			std::complex<float> const c = a0-0.5f*s;
+			std::complex<float> const r = std::complex<float>(-d.imag()*sin_third, d.real()*sin_third);
+
+			output[k]     = a0+s;
+			output[k+m]   = c+r;
+			output[k+2*m] = c-r;
+		}
+	}
+	else
+	{
+		// generic O(p^2) butterfly, the p-th roots of unity are the twiddles of index multiple of N/p
+		std::vector<std::complex<float> > a(p);
+		size_t const root_stride = N/p;
+		for(size_t k=0; k<m; ++k)
+		{
+			for(size_t q=0; q<p; ++q)
+				a[q] = output[k+q*m]*tw[q*k*stride];
+
+			for(size_t s=0; s<p; ++s)
+			{
+				std::complex<float> sum = a[0];
+				for(size_t q=1; q<p; ++q)
+					sum += a[q]*tw[((q*s)%p)*root_stride];
+				output[k+s*m] = sum;
+			}
+		}
+	}
+}
+
+
+void fft(buffer<std::complex<float> >& data)
+{
+	fft_plan const plan(data.size());
+	buffer<std::complex<float> > workspace(data.size());
+	plan.transform(data.data.data(), workspace.data.data(), false);
+}
+
+void inverse_fft(buffer<std::complex<float> >& data)
+{
+	fft_plan const plan(data.size());
+	buffer<std::complex<float> > workspace(data.size());
+	plan.transform(data.data.data(), workspace.data.data(), true);
+}
+
+
+// calls task(begin,end) on consecutive ranges covering [0,N), in parallel on the pool if any
+template <typename TASK>
+static void for_each_range(size_t N, size_t range_size, thread_pool* pool, TASK const& task)
+{
+	size_t const number_of_ranges = (N+range_size-1)/range_size;
+	auto const run_range = [&](size_t k) { task(k*range_size, std::min(N, (k+1)*range_size)); };
+
+	if(pool==nullptr)
+	{
+		for(size_t k=0; k<number_of_ranges; ++k)
+			run_range(k);
+	}
+	else
+		pool->run(number_of_ranges, run_range);
+}
+
+static void transform_2D(grid_2D<std::complex<float> >& data, bool inverse, thread_pool* pool)
+{
+	size_t const Nx = data.dimension.x;
+	size_t const Ny = data.dimension.y;
+	if(Nx==0 || Ny==0)
+		return;
+
+	std::complex<float>* values = data.data.data.data();
+
+	// rows are contiguous
+	fft_plan const row_plan(Nx);
+	for_each_range(Ny, 16, pool, [&](size_t y_begin, size_t y_end)
+	{
+		std::vector<std::complex<float> > workspace(Nx);
+		for(size_t y=y_begin; y<y_end; ++y)
+			row_plan.transform(values+Nx*y, workspace.data(), inverse);
+	});
+
+	// columns are gathered by blocks of 8, so that each cache line read is fully used
+	size_t const block = 8;
+	fft_plan const column_plan(Ny);
+	for_each_range(Nx, block, pool, [&](size_t x_begin, size_t x_end)
+	{
+		size_t const width = x_end-x_begin;
+		std::vector<std::complex<float> > columns(block*Ny);
+		std::vector<std::complex<float> > workspace(Ny);
+
+		for(size_t y=0; y<Ny; ++y)
+			for(size_t c=0; c<width; ++c)
+				columns[c*Ny+y] = values[x_begin+c+Nx*y];
+
+		for(size_t c=0; c<width; ++c)
+			column_plan.transform(columns.data()+c*Ny, workspace.data(), inverse);
+
+		for(size_t y=0; y<Ny; ++y)
+			for(size_t c=0; c<width; ++c)
+				values[x_begin+c+Nx*y] = columns[c*Ny+y];
+	});
+}
+
+void fft(grid_2D<std::complex<float> >& data)
+{
+	transform_2D(data, false, nullptr);
+}
+
+void fft(grid_2D<std::complex<float> >& data, thread_pool& pool)
+{
+	transform_2D(data, false, &pool);
+}
+
+void inverse_fft(grid_2D<std::complex<float> >& data)
+{
+	transform_2D(data, true, nullptr);
+}
+
+void inverse_fft(grid_2D<std::complex<float> >& data, thread_pool& pool)
+{
+	transform_2D(data, true, &pool);
+}
+
+grid_2D<std::complex<float> > fft(grid_2D<float> const& data)
+{
+	grid_2D<std::complex<float> > spectrum(data.dimension);
+	for(size_t k=0; k<data.size(); ++k)
+		spectrum[k] = data[k];
+	fft(spectrum);
+	return spectrum;
+}
+
+grid_2D<float> inverse_fft_real(grid_2D<std::complex<float> > const& data)
+{
+	grid_2D<std::complex<float> > values = data;
+	inverse_fft(values);
+
+	grid_2D<float> result(data.dimension);
+	float const normalization = 1.0f/float(data.size());
+	for(size_t k=0; k<data.size(); ++k)
+		result[k] = values[k].real()*normalization;
+	return result;
+}
+
+size_t fft_fast_size(size_t N)
+{
+	for(size_t n=std::max<size_t>(N,1); ; ++n)
+	{
+		size_t r = n;
+		for(size_t p : {2, 3, 5})
+			while(r%p==0)
+				r /= p;
+		if(r==1)
+			return n;
+	}
+}
+
+}
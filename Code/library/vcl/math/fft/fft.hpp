@@ -0,0 +1,63 @@
+#pragma once
+
+#include <complex>
+#include <vector>
+
+#include "vcl/containers/containers.hpp"
+
+namespace vcl
+{
+
+class thread_pool;
+
+/** Precomputed discrete Fourier transform of complex sequences of a given length
+ *
+ * The length is factored into radices 4, 2, 3, 5 and remaining primes, then transformed by mixed-radix Cooley-Tukey
+ * (powers of two only use the radix-4 and radix-2 butterflies). Any length is accepted, but lengths with large prime
+ * factors fall back on an O(p^2) butterfly for each such factor p.
+ *
+ * forward: X[k] = sum_n x[n] exp(-2i.pi.n.k/N)
+ * inverse: x[n] = sum_k X[k] exp(+2i.pi.n.k/N) (not normalized by 1/N)
+ */
+class fft_plan
+{
+public:
+	fft_plan();
+	fft_plan(size_t N);
+
+	size_t size() const;
+
+	/** Transform N contiguous elements in place, workspace must hold N elements */
+	void transform(std::complex<float>* data, std::complex<float>* workspace, bool inverse) const;
+
+private:
+	void transform_recursive(std::complex<float>* output, std::complex<float> const* input, size_t stride, size_t factor, bool inverse) const;
+	void butterfly(std::complex<float>* output, size_t stride, size_t p, size_t m, bool inverse) const;
+
+	size_t N;
+	std::vector<size_t> radices;
+	std::vector<std::complex<float> > twiddles;         // exp(-2i.pi.k/N)
+	std::vector<std::complex<float> > inverse_twiddles; // exp(+2i.pi.k/N)
+};
+
+
+/** In place 1D transforms (not normalized) */
+void fft(buffer<std::complex<float> >& data);
+void inverse_fft(buffer<std::complex<float> >& data);
+
+/** In place 2D transforms along both dimensions (not normalized)
+ * The rows, then the columns, are transformed in parallel when a thread pool is given. */
+void fft(grid_2D<std::complex<float> >& data);
+void fft(grid_2D<std::complex<float> >& data, thread_pool& pool);
+void inverse_fft(grid_2D<std::complex<float> >& data);
+void inverse_fft(grid_2D<std::complex<float> >& data, thread_pool& pool);
+
+/** Transform of a real grid */
+grid_2D<std::complex<float> > fft(grid_2D<float> const& data);
+/** Real part of the inverse transform, normalized by 1/(Nx.Ny) so that inverse_fft_real(fft(g)) = g */
+grid_2D<float> inverse_fft_real(grid_2D<std::complex<float> > const& data);
+
+/** Smallest length >= N whose prime factors are only 2, 3 and 5 */
+size_t fft_fast_size(size_t N);
+
+}
@@ -22,10 +22,10 @@ namespace vcl
         int const x1 = x0+1;
         int const y1 = y0+1;
 
-	    assert_vcl_no_msg(x0>=0 && x0<value.dimension.x);
-	    assert_vcl_no_msg(x1>=0 && x1<value.dimension.x);
-	    assert_vcl_no_msg(y0>=0 && y0<value.dimension.y);
-	    assert_vcl_no_msg(y1>=0 && y1<value.dimension.y);
+	    assert_vcl_no_msg(x0>=0 && x0<int(value.dimension.x));
+	    assert_vcl_no_msg(x1>=0 && x1<int(value.dimension.x));
+	    assert_vcl_no_msg(y0>=0 && y0<int(value.dimension.y));
+	    assert_vcl_no_msg(y1>=0 && y1<int(value.dimension.y));
 
 	    float const dx = x-x0;
         float const dy = y-y0;
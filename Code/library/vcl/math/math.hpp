@@ -8,3 +8,4 @@
 #include "frame/frame.hpp"
 #include "projection/projection.hpp"
 #include "interpolation/interpolation.hpp"
+#include "fft/fft.hpp"
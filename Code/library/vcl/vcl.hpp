@@ -20,6 +20,9 @@
 // To skip all VCL internal debug, declare VCL_NO_DEBUG as in the following line
 // #define VCL_NO_DEBUG
 
+// To build without OpenGL, GLFW and ImGui (batch rendering), declare VCL_HEADLESS: only the image writers of the display part are kept
+// #define VCL_HEADLESS
+
 
 #include "base/base.hpp"
 #include "containers/containers.hpp"
@@ -28,7 +31,12 @@
 
 #include "shape/shape.hpp"
 
+#ifndef VCL_HEADLESS
 #include "display/display.hpp"
 #include "shaders_preset/shaders_preset.hpp"
 
-#include "interaction/interaction.hpp"
\ No newline at end of file
+#include "interaction/interaction.hpp"
+#else
+#include "display/image/image.hpp"
+#include "display/image/raster.hpp"
+#endif
\ No newline at end of file
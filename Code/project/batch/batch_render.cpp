@@ -0,0 +1,247 @@
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <chrono>
+#include <cstdio>
+#include <stdexcept>
+#include <vector>
+#include "vcl/vcl.hpp"
+#include "Noise.h"
+#include "Noise_variants.h"
+#include "Tile_renderer.h"
+#include "../benchmarks/Benchmark_harness.h"
+
+#ifdef _WIN32
+#include <io.h>
+#include <fcntl.h>
+#endif
+
+using namespace std;
+using namespace vcl;
+
+//renders the noise images of a job file without any window, built without OpenGL, GLFW and ImGui (VCL_HEADLESS)
+//usage: batch_render job_file [--threads N] [--stdout] [--frame float|grey]
+//  --threads N      threads rendering the images, 0 (default) for all the hardware threads
+//  --stdout         every frame is streamed to the standard output instead of its file, the messages go to the error output
+//  --frame          format of the streamed frames: float (default, 32 bits floats of the intensities) or grey (8 bits, as in the pgm files)
+//
+//the job file holds one job per line as key=value pairs, # starts a comment, the missing keys keep the values of Main.cpp (seed 0 instead of the time):
+//  K=1 a=0.05 F0_min=0.125 F0_max=0.125 w0_min=0 w0_max=6.2832 density=64 seed=1 periodic=0 resolution=1024 output=../output/job1.png
+//the extension of the output gives its format: .pgm, .png (8 bits grey), .pfm (floats) or .raw (floats, no header)
+//an output "-" streams the frame to the standard output, the frames are row after row, top row first, without header
+//accuracy=exact|accurate|fast chooses the kernel as in Main.cpp
+
+struct Job {
+    float K = 1.f;
+    float a = 0.05f;
+    float F0_min = 0.125f;
+    float F0_max = 0.125f;
+    float w0_min = 0.f;
+    float w0_max = 2*pi;
+    float density = 64.f; //number of impulses per kernel
+    unsigned seed = 0;
+    bool is_periodic = false;
+    unsigned resolution = 256;
+    Kernel_accuracy accuracy = Kernel_accuracy::exact;
+    string output;
+};
+
+string extension_of (string const& file_name) {
+    size_t dot = file_name.find_last_of('.');
+    return dot == string::npos ? "" : file_name.substr(dot);
+}
+
+//reads the key=value pairs of a line into job, returns false with a message for an unknown key or a wrong value
+bool parse_job (string const& line, Job& job, string& message) {
+
+    istringstream pairs(line);
+    string pair;
+    while (pairs >> pair) {
+
+        size_t equal = pair.find('=');
+        if (equal == string::npos) {message = "expected key=value, got " + pair; return false;}
+        string key = pair.substr(0, equal);
+        istringstream value(pair.substr(equal + 1));
+
+        bool read = true;
+        if (key == "K") {read = bool(value >> job.K);}
+        else if (key == "a") {read = bool(value >> job.a);}
+        else if (key == "F0_min") {read = bool(value >> job.F0_min);}
+        else if (key == "F0_max") {read = bool(value >> job.F0_max);}
+        else if (key == "w0_min") {read = bool(value >> job.w0_min);}
+        else if (key == "w0_max") {read = bool(value >> job.w0_max);}
+        else if (key == "density") {read = bool(value >> job.density);}
+        else if (key == "seed") {read = bool(value >> job.seed);}
+        else if (key == "periodic") {read = bool(value >> job.is_periodic);}
+        else if (key == "resolution") {read = bool(value >> job.resolution) && job.resolution > 0;}
+        else if (key == "output") {job.output = value.str();}
+        else if (key == "accuracy") {
+            string accuracy = value.str();
+            if (accuracy == "exact") {job.accuracy = Kernel_accuracy::exact;}
+            else if (accuracy == "accurate") {job.accuracy = Kernel_accuracy::accurate;}
+            else if (accuracy == "fast") {job.accuracy = Kernel_accuracy::fast;}
+            else {read = false;}
+        }
+        else {message = "unknown key " + key; return false;}
+
+        if (!read) {message = "wrong value for " + key; return false;}
+    }
+
+    return true;
+
+}
+
+//same orientation as noise_image in Main.cpp: pixel (j,i) holds the intensity of the sample (i, resolution-1-j)
+raster<float> render_noise (Noise const& noise, unsigned resolution, thread_pool& pool) {
+
+    raster<float> image(resolution, resolution);
+    float origin = 0.5f - float(resolution)/2.f;
+
+    Tile_renderer(pool, 64).render(resolution, resolution, [&](unsigned x_begin, unsigned y_begin, unsigned width, unsigned height) {
+
+        vector<float> tile(width*height);
+        noise.evaluate_tile(origin + float(x_begin), origin + float(y_begin), width, height, 1.f, tile.data());
+
+        for (unsigned py=0 ; py<height ; py++) {
+            for (unsigned px=0 ; px<width ; px++) {
+                image(resolution - 1 - (y_begin + py), x_begin + px) = tile[py*width + px];
+            }
+        }
+
+    });
+
+    return image;
+
+}
+
+//the value is centered between 0 and 1 as in Main.cpp, 6 standard deviations giving the whole range
+raster<uint8_t> grey_levels (raster<float> const& intensities, float scale) {
+    raster<uint8_t> grey(intensities.width, intensities.height);
+    for (size_t k=0 ; k<grey.data.size() ; k++) {
+        grey.data[k] = static_cast<uint8_t>(min(max(0.5f + intensities.data[k]/scale, 0.f), 1.f)*255.f);
+    }
+    return grey;
+}
+
+bool write_frame (FILE* stream, void const* data, size_t size) {
+    return fwrite(data, 1, size, stream) == size && fflush(stream) == 0;
+}
+
+int main(int argc, char** argv) {
+
+    if (argc < 2) {
+        cerr<<"usage: batch_render job_file [--threads N] [--stdout] [--frame float|grey]"<<endl;
+        return 1;
+    }
+
+    string job_file = argv[1];
+    unsigned number_of_threads = 0;
+    bool stream_all = false;
+    bool grey_frames = false;
+    for (int k=2 ; k<argc ; k++) {
+        string option = argv[k];
+        if (option == "--threads" && k + 1 < argc) {number_of_threads = unsigned(atoi(argv[++k]));}
+        else if (option == "--stdout") {stream_all = true;}
+        else if (option == "--frame" && k + 1 < argc && (string(argv[k + 1]) == "grey" || string(argv[k + 1]) == "float")) {grey_frames = string(argv[++k]) == "grey";}
+        else {cerr<<"unknown option "<<option<<endl; return 1;}
+    }
+
+    ifstream jobs(job_file);
+    if (!jobs.is_open()) {
+        cerr<<"cannot read the job file "<<job_file<<endl;
+        return 1;
+    }
+
+#ifdef _WIN32
+    _setmode(_fileno(stdout), _O_BINARY);
+#endif
+
+    thread_pool pool(number_of_threads);
+
+    //the standard output may carry the frames, the messages then go to the error output
+    vector<string> lines;
+    bool any_streamed = stream_all;
+    for (string line ; getline(jobs, line) ; ) {
+        line = line.substr(0, line.find('#'));
+        lines.push_back(line);
+        any_streamed = any_streamed || line.find("output=-") != string::npos;
+    }
+    ostream& log = any_streamed ? cerr : cout;
+    log<<"threads: "<<pool.size()<<endl;
+
+    unsigned number_of_jobs = 0, number_of_failures = 0;
+    double total_samples = 0, total_time = 0;
+
+    for (size_t l=0 ; l<lines.size() ; l++) {
+
+        if (lines[l].find_first_not_of(" \t\r") == string::npos) {continue;}
+        number_of_jobs++;
+
+        Job job;
+        string message;
+        if (!parse_job(lines[l], job, message)) {
+            log<<job_file<<":"<<l + 1<<": "<<message<<", job skipped"<<endl;
+            number_of_failures++;
+            continue;
+        }
+
+        bool streamed = stream_all || job.output == "-";
+        string extension = extension_of(job.output);
+        if (!streamed && job.output.empty()) {
+            log<<job_file<<":"<<l + 1<<": no output, job skipped"<<endl;
+            number_of_failures++;
+            continue;
+        }
+        if (!streamed && extension != ".pgm" && extension != ".png" && extension != ".pfm" && extension != ".raw") {
+            log<<job_file<<":"<<l + 1<<": unknown format of "<<job.output<<", job skipped"<<endl;
+            number_of_failures++;
+            continue;
+        }
+
+        auto start = chrono::steady_clock::now();
+        shared_ptr<Noise> noise = make_noise(job.K, job.a, job.F0_min, job.F0_max, job.w0_min, job.w0_max, job.density, job.seed, job.is_periodic, job.accuracy);
+        raster<float> intensities = render_noise(*noise, job.resolution, pool);
+        double render_time = seconds_since(start);
+
+        start = chrono::steady_clock::now();
+        bool saved = true;
+        bool grey = streamed ? grey_frames : extension == ".pgm" || extension == ".png";
+        raster<uint8_t> grey_image;
+        if (grey) {grey_image = grey_levels(intensities, 6.f*sqrt(noise->variance()));}
+
+        //the errors of the vcl writers are exceptions in this target (VCL_ERROR_EXCEPTION), a failed job does not stop the batch
+        try {
+            if (streamed) {
+                saved = grey ? write_frame(stdout, grey_image.data.data.data(), grey_image.data.size())
+                             : write_frame(stdout, intensities.data.data.data(), sizeof(float)*intensities.data.size());
+            }
+            else if (extension == ".pgm") {image_save_pgm(job.output, grey_image);}
+            else if (extension == ".png") {image_save_png(job.output, raster_view<uint8_t const>(grey_image), png_compression::fast, pool);}
+            else if (extension == ".pfm") {image_save_pfm(job.output, intensities);}
+            else {
+                ofstream file(job.output, ios::binary);
+                file.write(reinterpret_cast<char const*>(intensities.data.data.data()), streamsize(sizeof(float)*intensities.data.size()));
+                saved = bool(file);
+            }
+        }
+        catch (exception const&) {
+            saved = false;
+        }
+        double write_time = seconds_since(start);
+
+        double samples = double(job.resolution)*job.resolution;
+        total_samples += samples;
+        total_time += render_time;
+        log<<"job "<<number_of_jobs<<" ("<<job.resolution<<"x"<<job.resolution<<" -> "<<(streamed ? "stdout" : job.output)<<"): "
+           <<1e-6*samples/render_time<<" Msamples/s, render "<<render_time<<" s, write "<<write_time<<" s"<<(saved ? "" : ", writing failed")<<endl;
+        if (!saved) {number_of_failures++;}
+
+    }
+
+    if (total_time > 0) {
+        log<<number_of_jobs - number_of_failures<<"/"<<number_of_jobs<<" jobs rendered, "<<1e-6*total_samples/total_time<<" Msamples/s overall"<<endl;
+    }
+
+    return number_of_failures == 0 ? 0 : 1;
+
+}
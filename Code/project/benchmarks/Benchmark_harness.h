@@ -0,0 +1,271 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <ctime>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifdef __linux__
+#include <sched.h>
+#endif
+
+using namespace std;
+
+//seconds elapsed since start, for the timings taken once, as the jobs of batch_render
+inline double seconds_since (chrono::steady_clock::time_point start) {
+    return chrono::duration<double>(chrono::steady_clock::now() - start).count();
+}
+
+
+//times small operations of the hot paths: each measurement repeats body() enough times to last min_run_seconds,
+//the first warm_up_runs measurements are dropped, the next runs ones give the median and the percentiles in ns per call
+//to keep the clock frequency stable during the suite the thread is pinned to its core, the core is kept busy before the
+//first measurement, and a fixed reference loop timed at the start and at the end tells whether the frequency drifted
+//body() returns a number, summed into a volatile sink so that the compiler cannot remove the work
+//an operation lasting longer than min_run_seconds is called once per run, the settings of long_runs() then keep the suite short
+//a suite timing a thread_pool is not pinned (pin_to_core false), or its threads would share the core of the harness
+
+class Benchmark_harness {
+
+    public:
+
+        struct Settings {
+            unsigned warm_up_runs = 3;
+            unsigned runs = 15;
+            double min_run_seconds = 0.02;
+            double spin_up_seconds = 0.3;
+            bool pin_to_core = true;
+        };
+
+        //one warm up run and a few single calls, for operations of a second or more
+        static Settings long_runs (unsigned runs=3) {
+            Settings settings;
+            settings.warm_up_runs = 1;
+            settings.runs = runs;
+            settings.min_run_seconds = 0;
+            return settings;
+        }
+
+        struct Result {
+            string name;
+            string parameters;
+            size_t iterations_per_run;
+            vector<double> nanoseconds; //per call, one value per timed run, sorted
+            double median, p10, p90, p99, min, max, mean;
+        };
+
+
+        //with pin_to_core, the threads started afterwards by this thread are pinned to the same core
+        Benchmark_harness (string suite, Settings settings)
+        :  m_suite(suite), m_settings(settings), m_sink(0)
+        {
+            m_pinned = m_settings.pin_to_core && pin_to_current_core();
+            spin_up(m_settings.spin_up_seconds);
+            m_reference_start = reference_nanoseconds();
+        }
+
+        Benchmark_harness (string suite)
+        :  Benchmark_harness(suite, Settings())
+        {}
+
+
+        //times body(), the name identifies the hot path and the parameters the set of values it runs with
+        template <typename Body>
+        Result const& run (string const& name, string const& parameters, Body const& body) {
+
+            //iterations per run from a first single call, then refined on the first warm up run
+            size_t iterations = 1;
+            double seconds = time_calls(body, iterations);
+            while (seconds < m_settings.min_run_seconds) {
+                double factor = seconds > 0 ? min(100.0, 1.2*m_settings.min_run_seconds/seconds) : 100.0;
+                iterations = max(iterations + 1, size_t(double(iterations)*factor));
+                seconds = time_calls(body, iterations);
+            }
+
+            for (unsigned k=1 ; k<m_settings.warm_up_runs ; k++) {time_calls(body, iterations);}
+
+            Result result;
+            result.name = name;
+            result.parameters = parameters;
+            result.iterations_per_run = iterations;
+            for (unsigned k=0 ; k<m_settings.runs ; k++) {
+                result.nanoseconds.push_back(1e9*time_calls(body, iterations)/double(iterations));
+            }
+            sort(result.nanoseconds.begin(), result.nanoseconds.end());
+            result.median = percentile(result.nanoseconds, 0.5);
+            result.p10 = percentile(result.nanoseconds, 0.1);
+            result.p90 = percentile(result.nanoseconds, 0.9);
+            result.p99 = percentile(result.nanoseconds, 0.99);
+            result.min = result.nanoseconds.front();
+            result.max = result.nanoseconds.back();
+            result.mean = 0;
+            for (double t : result.nanoseconds) {result.mean += t/double(result.nanoseconds.size());}
+
+            cout<<name<<" ["<<parameters<<"]: median "<<duration(result.median)<<", p10 "<<duration(result.p10)<<", p90 "<<duration(result.p90)<<" ("<<iterations<<" calls per run)"<<endl;
+
+            m_results.push_back(result);
+            return m_results.back();
+
+        }
+
+
+        //relative change of the reference loop between the start and now, above a few percents the timings are not comparable
+        double frequency_drift () const {
+            return reference_nanoseconds()/m_reference_start - 1.0;
+        }
+
+
+        //prints the frequency drift and writes the results to the json file, returns false if it cannot be written
+        bool report (string const& file_name) const {
+            double drift = frequency_drift();
+            cout<<"reference loop drift: "<<100*drift<<" %"<<(fabs(drift) > 0.05 ? ", the clock frequency changed during the run, compare the results with care" : "")<<endl;
+            if (!write_json(file_name)) {
+                cout<<"cannot write "<<file_name<<endl;
+                return false;
+            }
+            cout<<"results written to "<<file_name<<endl;
+            return true;
+        }
+
+
+        //writes the settings, the reference timings and every result, returns false if the file cannot be written
+        bool write_json (string const& file_name) const {
+
+            double reference_end = reference_nanoseconds();
+
+            ostringstream json;
+            json.precision(6);
+            json<<"{\n";
+            json<<"  \"suite\": \""<<escape(m_suite)<<"\",\n";
+            json<<"  \"time\": "<<time(0)<<",\n";
+            json<<"  \"hardware_threads\": "<<thread::hardware_concurrency()<<",\n";
+            json<<"  \"pinned_to_core\": "<<(m_pinned ? "true" : "false")<<",\n";
+            json<<"  \"settings\": {\"warm_up_runs\": "<<m_settings.warm_up_runs<<", \"runs\": "<<m_settings.runs<<", \"min_run_seconds\": "<<m_settings.min_run_seconds<<"},\n";
+            json<<"  \"reference_ns\": {\"start\": "<<m_reference_start<<", \"end\": "<<reference_end<<", \"drift\": "<<reference_end/m_reference_start - 1.0<<"},\n";
+            json<<"  \"results\": [";
+            for (size_t k=0 ; k<m_results.size() ; k++) {
+                Result const& r = m_results[k];
+                json<<(k > 0 ? "," : "")<<"\n    {\"name\": \""<<escape(r.name)<<"\", \"parameters\": \""<<escape(r.parameters)<<"\", \"unit\": \"ns\", "
+                    <<"\"iterations_per_run\": "<<r.iterations_per_run<<", \"runs\": "<<r.nanoseconds.size()<<", "
+                    <<"\"median\": "<<r.median<<", \"p10\": "<<r.p10<<", \"p90\": "<<r.p90<<", \"p99\": "<<r.p99<<", "
+                    <<"\"min\": "<<r.min<<", \"max\": "<<r.max<<", \"mean\": "<<r.mean<<"}";
+            }
+            json<<"\n  ]\n}\n";
+
+            ofstream file(file_name);
+            file<<json.str();
+            return bool(file);
+
+        }
+
+
+        vector<Result> const& results () const {
+            return m_results;
+        }
+
+
+    private:
+
+        template <typename Body>
+        double time_calls (Body const& body, size_t iterations) {
+            double sum = 0;
+            auto start = chrono::steady_clock::now();
+            for (size_t k=0 ; k<iterations ; k++) {sum += double(body());}
+            double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+            m_sink = m_sink + sum;
+            return seconds;
+        }
+
+
+        //linear interpolation between the closest ranks of sorted values
+        static double percentile (vector<double> const& sorted, double q) {
+            double rank = q*double(sorted.size() - 1);
+            size_t below = size_t(floor(rank));
+            size_t above = min(below + 1, sorted.size() - 1);
+            return sorted[below] + (rank - double(below))*(sorted[above] - sorted[below]);
+        }
+
+
+        //the scheduler can no longer move the thread to a core running at another frequency
+        static bool pin_to_current_core () {
+#ifdef __linux__
+            int core = sched_getcpu();
+            if (core < 0) {return false;}
+            cpu_set_t cores;
+            CPU_ZERO(&cores);
+            CPU_SET(core, &cores);
+            return sched_setaffinity(0, sizeof(cores), &cores) == 0;
+#else
+            return false;
+#endif
+        }
+
+
+        //busy loop bringing the core out of its low power states before the first measurement
+        void spin_up (double seconds) {
+            auto start = chrono::steady_clock::now();
+            while (chrono::duration<double>(chrono::steady_clock::now() - start).count() < seconds) {
+                m_sink = m_sink + reference_work();
+            }
+        }
+
+
+        //fixed integer work whose duration only depends on the clock frequency
+        static double reference_work () {
+            volatile unsigned seed = 1; //unknown to the compiler, which cannot compute the loop in advance
+            unsigned x = seed;
+            for (unsigned k=0 ; k<100000 ; k++) {x = x*1664525u + 1013904223u;}
+            return double(x);
+        }
+
+        //median duration of the reference work
+        double reference_nanoseconds () const {
+            vector<double> times;
+            double sum = 0;
+            for (unsigned k=0 ; k<21 ; k++) {
+                auto start = chrono::steady_clock::now();
+                sum += reference_work();
+                times.push_back(1e9*chrono::duration<double>(chrono::steady_clock::now() - start).count());
+            }
+            m_sink = m_sink + sum;
+            sort(times.begin(), times.end());
+            return times[times.size()/2];
+        }
+
+
+        //nanoseconds in the unit that fits them
+        static string duration (double nanoseconds) {
+            ostringstream text;
+            text.precision(4);
+            if (nanoseconds < 1e3) {text<<nanoseconds<<" ns";}
+            else if (nanoseconds < 1e6) {text<<1e-3*nanoseconds<<" us";}
+            else if (nanoseconds < 1e9) {text<<1e-6*nanoseconds<<" ms";}
+            else {text<<1e-9*nanoseconds<<" s";}
+            return text.str();
+        }
+
+
+        static string escape (string const& text) {
+            string escaped;
+            for (char c : text) {
+                if (c == '"' || c == '\\') {escaped += '\\';}
+                escaped += c;
+            }
+            return escaped;
+        }
+
+
+        string m_suite;
+        Settings m_settings;
+        bool m_pinned;
+        double m_reference_start;
+        vector<Result> m_results;
+        mutable volatile double m_sink;
+
+};
@@ -0,0 +1,106 @@
+#include <iostream>
+#include <vector>
+#include "vcl/vcl.hpp"
+#include "Noise.h"
+#include "Noise_variants.h"
+#include "Pseudo_random_number_generator.h"
+#include "Benchmark_harness.h"
+
+using namespace std;
+using namespace vcl;
+
+//median and percentiles of the cost of the hot paths, written to a json file to compare versions:
+//cell_noise, the poisson draw of the number of impulses and power_spectrum for representative parameter sets,
+//normal_per_vertex and mesh_load_file_obj on the meshes of the assets
+//usage: hot_paths_benchmark [json_file] [filter] (run from Code/project/build or a sibling folder), only the names containing filter are run
+
+struct Parameter_set {
+    string name;
+    float K, a, F0_min, F0_max, w0_min, w0_max, number_of_impulses_per_kernel;
+    bool is_periodic;
+};
+
+int main(int argc, char** argv) {
+
+    string json_file = argc > 1 ? argv[1] : "../output/hot_paths_benchmark.json";
+    string filter = argc > 2 ? argv[2] : "";
+    auto selected = [&](string const& name) {return name.find(filter) != string::npos;};
+
+    vector<Parameter_set> parameter_sets = {
+        {"isotropic", 1.f, 0.05f, 0.125f, 0.125f, 0.f, 2*pi, 64.f, false},
+        {"anisotropic", 1.f, 0.05f, 0.125f, 0.125f, pi/4, pi/4, 64.f, false},
+        {"wide_F0_band", 1.f, 0.05f, 0.0625f, 0.25f, 0.f, 2*pi, 64.f, false},
+        {"periodic", 1.f, 0.05f, 0.125f, 0.125f, 0.f, 2*pi, 64.f, true},
+        {"high_density", 1.f, 0.05f, 0.125f, 0.125f, 0.f, 2*pi, 256.f, false}
+    };
+
+    Benchmark_harness harness("hot_paths");
+
+    for (Parameter_set const& p : parameter_sets) {
+
+        shared_ptr<Noise> noise = make_noise(p.K, p.a, p.F0_min, p.F0_max, p.w0_min, p.w0_max, p.number_of_impulses_per_kernel, 1u, p.is_periodic);
+
+        //a new cell at each call, as when a tile is rendered without the impulse cache
+        if (selected("cell_noise")) {
+            int cell = 0;
+            harness.run("cell_noise", p.name, [&]() {
+                cell++;
+                return noise->cell_noise(cell % 1024, cell / 1024, 0.3f, 0.7f);
+            });
+        }
+
+        //number of impulses of a cell: the mean is the density times the area of a cell (the square of the kernel radius)
+        if (selected("poisson")) {
+            float mean = p.number_of_impulses_per_kernel/pi;
+            Pseudo_random_number_generator knuth(1u);
+            harness.run("poisson_knuth", p.name, [&]() {return knuth.poisson(mean);});
+            Poisson_table table(mean);
+            Pseudo_random_number_generator tabulated(1u);
+            harness.run("poisson_table", p.name, [&]() {return tabulated.poisson(table);});
+        }
+
+        //frequencies spread over the band of the spectrum images, without the memo
+        if (selected("power_spectrum")) {
+            unsigned k = 0;
+            harness.run("power_spectrum", p.name, [&]() {
+                k = k*1664525u + 1013904223u;
+                float fx = (float(k & 0xffff)/65535.f - 0.5f)*0.6f;
+                float fy = (float(k >> 16)/65535.f - 0.5f)*0.6f;
+                return noise->power_spectrum(fx, fy);
+            });
+        }
+
+    }
+
+    //the mesh paths do not depend on the noise parameters
+    if (selected("normal_per_vertex") || selected("mesh_load_file_obj")) {
+        for (string mesh_name : {"man", "face"}) {
+            string file_name = "../assets/" + mesh_name + ".obj";
+            mesh shape = mesh_load_file_obj(file_name);
+            string parameters = mesh_name + ".obj, " + str(shape.position.size()) + " vertices";
+            if (selected("normal_per_vertex")) {
+                buffer<vec3> normals;
+                harness.run("normal_per_vertex", parameters, [&]() {
+                    normal_per_vertex(shape.position, shape.connectivity, normals);
+                    return normals[0].x;
+                });
+            }
+            if (selected("mesh_load_file_obj")) {
+                harness.run("mesh_load_file_obj", parameters, [&]() {return mesh_load_file_obj(file_name).position.size();});
+            }
+        }
+        mesh grid = mesh_primitive_grid({-1,-1,0}, {1,-1,0}, {1,1,0}, {-1,1,0}, 500, 500);
+        if (selected("normal_per_vertex")) {
+            buffer<vec3> normals;
+            harness.run("normal_per_vertex", "grid 500x500", [&]() {
+                normal_per_vertex(grid.position, grid.connectivity, normals);
+                return normals[0].x;
+            });
+        }
+    }
+
+    harness.report(json_file);
+
+    return 0;
+
+}
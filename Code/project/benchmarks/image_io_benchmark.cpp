@@ -0,0 +1,118 @@
+#include <iostream>
+#include <fstream>
+#include <cstring>
+#include <iterator>
+#include <vector>
+#include "vcl/vcl.hpp"
+#include "Vec3.h"
+#include "Benchmark_harness.h"
+
+using namespace std;
+using namespace vcl;
+
+//writes a resolution^2 black and white image as the former save_as_ppm did (vector<Vec3f> of 0..255 taken by value, one << per byte)
+//and with the raster writers of vcl (8 bits grey pgm and rgb ppm in bulk), then checks that 16 bits pgm and pfm give back the values written
+//usage: image_io_benchmark [resolution] [folder] [json_file] (run from Code/project/build or a sibling folder)
+
+vector<char> file_content (string file_name) {
+    ifstream file(file_name, ios::binary);
+    return vector<char>(istreambuf_iterator<char>(file), istreambuf_iterator<char>());
+}
+
+//the former writer of Main.cpp
+void save_as_ppm (vector<Vec3f> image, unsigned resolution, string file_name) {
+
+    ofstream file;
+    file.open(file_name);
+    file<<"P6\n"<<resolution<<" "<<resolution<<"\n255\n";
+
+    Vec3f color;
+    for (unsigned i=0 ; i<resolution ; i++) {
+        for (unsigned j=0 ; j<resolution ; j++) {
+            color = image[i*resolution + j];
+            file<<static_cast<unsigned char>(color[0])<<static_cast<unsigned char>(color[1])<<static_cast<unsigned char>(color[2]);
+        }
+    }
+
+    file.close();
+}
+
+int main(int argc, char** argv) {
+
+    unsigned resolution = argc > 1 ? unsigned(atoi(argv[1])) : 4096;
+    string folder = argc > 2 ? argv[2] : "../output/";
+    string json_file = argc > 3 ? argv[3] : folder + "image_io_benchmark.json";
+
+    raster<float> values(resolution, resolution);
+    for (float& v : values.data) v = rand_interval(-0.2f, 1.2f);
+
+    Benchmark_harness harness("image_io", Benchmark_harness::long_runs(5));
+    string parameters = str(resolution) + "x" + str(resolution);
+
+    //former pipeline
+    double former_time = 1e-9*harness.run("vector<Vec3f> and save_as_ppm", parameters, [&]() {
+        vector<Vec3f> image(size_t(resolution)*resolution);
+        for (size_t k=0 ; k<image.size() ; k++) {
+            image[k] = min(max(values.data[k], 0.f), 1.f)*Vec3f(255,255,255);
+        }
+        save_as_ppm(image, resolution, folder + "image_io_former.ppm");
+        return 0;
+    }).median;
+
+    //rasters
+    raster<uint8_t> grey;
+    double pgm_time = 1e-9*harness.run("raster<uint8_t> and image_save_pgm", parameters, [&]() {
+        grey = raster<uint8_t>(resolution, resolution);
+        for (size_t k=0 ; k<grey.data.size() ; k++) {
+            grey.data[k] = static_cast<uint8_t>(min(max(values.data[k], 0.f), 1.f)*255.f);
+        }
+        image_save_pgm(folder + "image_io.pgm", grey);
+        return 0;
+    }).median;
+
+    double ppm_time = 1e-9*harness.run("raster<pixel_rgb8> and image_save_ppm", parameters, [&]() {
+        raster<pixel_rgb8> rgb(resolution, resolution);
+        for (size_t k=0 ; k<rgb.data.size() ; k++) {
+            rgb.data[k] = {grey.data[k], grey.data[k], grey.data[k]};
+        }
+        image_save_ppm(folder + "image_io.ppm", rgb);
+        return 0;
+    }).median;
+
+    bool same_ppm = file_content(folder + "image_io.ppm") == file_content(folder + "image_io_former.ppm");
+
+    //16 bits heightmap and floats, read back from the end of the files (pfm rows go from bottom to top)
+    raster<uint16_t> heights(resolution, resolution);
+    for (size_t k=0 ; k<heights.data.size() ; k++) {
+        heights.data[k] = uint16_t(k*2654435761u >> 16);
+    }
+    image_save_pgm(folder + "image_io_16.pgm", heights);
+    vector<char> bytes = file_content(folder + "image_io_16.pgm");
+    size_t offset = bytes.size() - 2*heights.data.size();
+    bool same_heights = true;
+    for (size_t k=0 ; k<heights.data.size() ; k++) {
+        uint16_t h = uint16_t((uint8_t(bytes[offset + 2*k]) << 8) | uint8_t(bytes[offset + 2*k + 1]));
+        same_heights = same_heights && h == heights.data[k];
+    }
+
+    double pfm_time = 1e-9*harness.run("image_save_pfm", parameters, [&]() {
+        image_save_pfm(folder + "image_io.pfm", values);
+        return 0;
+    }).median;
+    bytes = file_content(folder + "image_io.pfm");
+    offset = bytes.size() - sizeof(float)*values.data.size();
+    bool same_floats = true;
+    for (unsigned y=0 ; y<resolution ; y++) {
+        same_floats = same_floats && memcmp(&bytes[offset + sizeof(float)*size_t(resolution - 1 - y)*resolution], &values(0, y), sizeof(float)*resolution) == 0;
+    }
+
+    cout<<"image "<<resolution<<"x"<<resolution<<endl;
+    cout<<"former vector<Vec3f> and save_as_ppm: "<<1e3*former_time<<" ms, "<<size_t(resolution)*resolution*sizeof(Vec3f)/1024<<" kB of pixels"<<endl;
+    cout<<"raster<uint8_t> and image_save_pgm: "<<1e3*pgm_time<<" ms, "<<grey.data.size()/1024<<" kB of pixels, speedup "<<former_time/pgm_time<<endl;
+    cout<<"raster<pixel_rgb8> and image_save_ppm: "<<1e3*ppm_time<<" ms, "<<(same_ppm ? "same file as before" : "different file")<<endl;
+    cout<<"image_save_pfm: "<<1e3*pfm_time<<" ms, floats "<<(same_floats ? "identical" : "different")<<", 16 bits heights "<<(same_heights ? "identical" : "different")<<endl;
+    harness.report(json_file);
+
+    return 0;
+
+}
@@ -0,0 +1,92 @@
+#include <iostream>
+#include <fstream>
+#include <iterator>
+#include <vector>
+#include "vcl/vcl.hpp"
+#include "Noise.h"
+#include "Benchmark_harness.h"
+
+using namespace std;
+using namespace vcl;
+
+//noise image written to png by lodepng (image_save_png without pool) and by the multithreaded writer at each compression level,
+//every file being read back with image_load_png and compared to the pixels written
+//usage: png_encoder_benchmark [number_of_threads] [resolution] [folder] [json_file] (run from Code/project/build or a sibling folder)
+
+size_t file_size (string file_name) {
+    ifstream file(file_name, ios::binary | ios::ate);
+    return size_t(file.tellg());
+}
+
+int main(int argc, char** argv) {
+
+    unsigned number_of_threads = argc > 1 ? unsigned(atoi(argv[1])) : 0;
+    unsigned resolution = argc > 2 ? unsigned(atoi(argv[2])) : 2048;
+    string folder = argc > 3 ? argv[3] : "../output/";
+    string json_file = argc > 4 ? argv[4] : folder + "png_encoder_benchmark.json";
+
+    thread_pool pool(number_of_threads);
+    cout<<"threads: "<<pool.size()<<", image: "<<resolution<<"x"<<resolution<<endl;
+
+    //rgb noise image, the usual kind of output of the project
+    Noise noise(1.f, 0.05f, 0.125f, 0.125f, 0.f, 2*pi, 64.f, 1u, false);
+    float scale = 6.f*sqrt(noise.variance());
+    float origin = 0.5f - float(resolution)/2.f;
+    vector<float> values(size_t(resolution)*resolution);
+    noise.evaluate_tile(origin, origin, resolution, resolution, 1.f, values.data());
+
+    image_raw image(resolution, resolution, image_color_type::rgb, buffer<unsigned char>(3*values.size()));
+    for (size_t k=0 ; k<values.size() ; k++) {
+        float t = min(max(0.5f + values[k]/scale, 0.f), 1.f);
+        image.data[3*k+0] = static_cast<unsigned char>(255.f*t);
+        image.data[3*k+1] = static_cast<unsigned char>(255.f*t*t);
+        image.data[3*k+2] = static_cast<unsigned char>(255.f*(1.f - t));
+    }
+
+    auto check = [&](string file_name) {
+        image_raw loaded = image_load_png(file_name, image_color_type::rgb);
+        return loaded.width == image.width && loaded.height == image.height && loaded.data.data == image.data.data;
+    };
+
+    Benchmark_harness::Settings settings = Benchmark_harness::long_runs(5);
+    settings.pin_to_core = false;
+    Benchmark_harness harness("png_encoder", settings);
+    string parameters = "rgb " + str(resolution) + "x" + str(resolution);
+
+    double lodepng_time = 1e-9*harness.run("lodepng", parameters, [&]() {
+        image_save_png(folder + "png_lodepng.png", image);
+        return 0;
+    }).median;
+    cout<<"lodepng: "<<1e3*lodepng_time<<" ms, "<<file_size(folder + "png_lodepng.png")/1024<<" kB"<<endl;
+
+    vector<pair<png_compression, string>> levels = {{png_compression::store, "store"}, {png_compression::fast, "fast"}, {png_compression::normal, "normal"}};
+    for (auto const& level : levels) {
+        string file_name = folder + "png_" + level.second + ".png";
+        double time = 1e-9*harness.run("image_save_png " + level.second, parameters, [&]() {
+            image_save_png(file_name, image, level.first, pool);
+            return 0;
+        }).median;
+        cout<<level.second<<": "<<1e3*time<<" ms, "<<file_size(file_name)/1024<<" kB, speedup "<<lodepng_time/time
+            <<", pixels read back "<<(check(file_name) ? "identical" : "different")<<endl;
+    }
+
+    //grey raster and a view of a part of it, whose rows are not contiguous
+    raster<uint8_t> grey(resolution, resolution);
+    for (size_t k=0 ; k<values.size() ; k++) {
+        grey.data[k] = static_cast<uint8_t>(255.f*min(max(0.5f + values[k]/scale, 0.f), 1.f));
+    }
+    raster_view<uint8_t const> part = grey.view().sub_view(resolution/4, resolution/4, resolution/2, resolution/3);
+    image_save_png(folder + "png_grey.png", part, png_compression::fast, pool);
+    image_raw loaded = image_load_png(folder + "png_grey.png", image_color_type::rgb);
+    bool same_grey = loaded.width == part.width && loaded.height == part.height;
+    for (unsigned y=0 ; same_grey && y<part.height ; y++) {
+        for (unsigned x=0 ; x<part.width ; x++) {
+            same_grey = same_grey && loaded.data[3*(x + size_t(part.width)*y)] == part(x, y);
+        }
+    }
+    cout<<"grey sub view: pixels read back "<<(same_grey ? "identical" : "different")<<endl;
+    harness.report(json_file);
+
+    return 0;
+
+}
@@ -0,0 +1,103 @@
+#include <iostream>
+#include <vector>
+#include "vcl/vcl.hpp"
+#include "Noise_variants.h"
+#include "Benchmark_harness.h"
+
+using namespace std;
+using namespace vcl;
+
+//compares the spectrum engine with the per pixel integral of Noise::power_spectrum on the 256x256 spectrum image
+//both integrate adaptively to the relative tolerance, the difference is relative to the largest value of the image
+//the pixels read through the spectrum memo, every pixel once, have to be equal to the ones of the engine
+//usage: power_spectrum_benchmark [number_of_threads] [resolution] [tolerance] [json_file] (run from Code/project/build or a sibling folder)
+
+int main(int argc, char** argv) {
+
+    unsigned number_of_threads = argc > 1 ? unsigned(atoi(argv[1])) : 0;
+    unsigned resolution = argc > 2 ? unsigned(atoi(argv[2])) : 256;
+    float tolerance = argc > 3 ? float(atof(argv[3])) : 1e-3f;
+    string json_file = argc > 4 ? argv[4] : "../output/power_spectrum_benchmark.json";
+
+    thread_pool pool(number_of_threads);
+    cout<<"threads: "<<pool.size()<<", resolution: "<<resolution<<", tolerance: "<<tolerance<<endl;
+
+    //one set of parameters per case of power_spectrum, and the radial ones of the engine
+    struct Parameters { string name; float F0_min, F0_max, w0_min, w0_max; };
+    vector<Parameters> parameters = {
+        {"anisotropic", 0.125f, 0.125f, pi/4.f, pi/4.f},
+        {"isotropic", 0.125f, 0.125f, 0.f, 2.f*pi},
+        {"orientation band", 0.125f, 0.125f, 0.f, pi/4.f},
+        {"frequency band", 0.1f, 0.3f, pi/4.f, pi/4.f},
+        {"isotropic frequency band", 0.1f, 0.3f, 0.f, 2.f*pi},
+        {"general", 0.1f, 0.3f, 0.f, pi/4.f}
+    };
+
+    Benchmark_harness::Settings settings = Benchmark_harness::long_runs();
+    settings.pin_to_core = false;
+    Benchmark_harness harness("power_spectrum", settings);
+
+    float extent = 1.1f;
+    auto frequency = [&](unsigned x) {
+        return (float(x) + 0.5f - float(resolution)/2.f)*2.f*extent/float(resolution);
+    };
+
+    for (Parameters const& p : parameters) {
+
+        shared_ptr<Noise> noise = make_noise(1.f, 0.05f, p.F0_min, p.F0_max, p.w0_min, p.w0_max, 64.f, 1u, false);
+        noise->set_integration_tolerance(tolerance);
+
+        string image = p.name + ", " + str(resolution) + "x" + str(resolution);
+
+        vector<float> reference(size_t(resolution)*resolution);
+        double reference_time = 1e-9*harness.run("power_spectrum", image, [&]() {
+            pool.run(resolution, [&](size_t y) {
+                for (unsigned x=0 ; x<resolution ; x++) {
+                    reference[y*resolution + x] = noise->power_spectrum(frequency(x), frequency(unsigned(y)));
+                }
+            });
+            return reference[0];
+        }).median;
+
+        vector<float> spectrum(size_t(resolution)*resolution);
+        Spectrum_engine const engine = noise->spectrum_engine();
+        double engine_time = 1e-9*harness.run("spectrum_engine", image, [&]() {
+            noise->spectrum_engine().render(resolution, extent, spectrum.data(), pool);
+            return spectrum[0];
+        }).median;
+
+        //a new memo at each run, so that every pixel is evaluated once by the run
+        vector<float> memorized(size_t(resolution)*resolution);
+        double memo_time = 1e-9*harness.run("spectrum_memo", image, [&]() {
+            noise->enable_spectrum_memo(resolution, extent);
+            pool.run(resolution, [&](size_t y) {
+                for (unsigned x=0 ; x<resolution ; x++) {
+                    memorized[y*resolution + x] = noise->spectrum_pixel(x, unsigned(y), resolution, extent);
+                }
+            });
+            return memorized[0];
+        }).median;
+        Spectrum_memo::Statistics memo = noise->spectrum_memo_statistics();
+        noise->disable_spectrum_memo();
+
+        float largest = 0.f;
+        float difference = 0.f;
+        size_t memo_mismatches = 0;
+        for (size_t k=0 ; k<spectrum.size() ; k++) {
+            largest = max(largest, fabs(reference[k]));
+            difference = max(difference, fabs(spectrum[k] - reference[k]));
+            if (memorized[k] != spectrum[k]) {memo_mismatches++;}
+        }
+
+        cout<<p.name<<(engine.is_radial() ? " (radial)" : "")<<": power_spectrum "<<reference_time<<" s, engine "<<engine_time<<" s"
+            <<", speedup "<<reference_time/engine_time<<", largest difference "<<100.f*difference/largest<<" %"<<endl;
+        cout<<"    memo "<<memo_time<<" s, "<<memo.misses<<" pixels evaluated, "<<memo.hits<<" read back, "
+            <<(memo_mismatches == 0 ? "equal to the engine" : to_string(memo_mismatches) + " pixels differ from the engine")<<endl;
+
+    }
+
+    harness.report(json_file);
+
+    return 0;
+
+}
@@ -0,0 +1,90 @@
+#include <iostream>
+#include <vector>
+#include "vcl/vcl.hpp"
+#include "Noise_variants.h"
+#include "Benchmark_harness.h"
+
+using namespace std;
+using namespace vcl;
+
+//compares the fft spectral synthesis with the sparse convolution on full noise images of 1k, 4k and 16k pixels
+//the sparse convolution of the large images is timed on a band of rows and extrapolated to the full image
+//each image is synthesized twice, the first time as a warm up, as the 16k images take tens of seconds
+//usage: spectral_synthesis_benchmark [number_of_threads] [largest_resolution] [json_file] (run from Code/project/build or a sibling folder)
+
+int main(int argc, char** argv) {
+
+    unsigned number_of_threads = argc > 1 ? unsigned(atoi(argv[1])) : 0;
+    unsigned largest_resolution = argc > 2 ? unsigned(atoi(argv[2])) : 16384;
+    string json_file = argc > 3 ? argv[3] : "../output/spectral_synthesis_benchmark.json";
+
+    thread_pool pool(number_of_threads);
+    cout<<"threads: "<<pool.size()<<endl;
+
+    //anisotropic, isotropic and banded noise, as in the interactive 2D noise
+    struct Parameters { string name; float F0_min, F0_max, w0_min, w0_max; };
+    vector<Parameters> parameters = {
+        {"anisotropic", 0.125f, 0.125f, pi/4.f, pi/4.f},
+        {"isotropic", 0.125f, 0.125f, 0.f, 2.f*pi},
+        {"banded", 0.1f, 0.3f, 0.f, pi/4.f}
+    };
+
+    Benchmark_harness::Settings settings = Benchmark_harness::long_runs(1);
+    settings.pin_to_core = false;
+    Benchmark_harness harness("spectral_synthesis", settings);
+
+    for (Parameters const& p : parameters) {
+
+        shared_ptr<Noise> noise = make_noise(1.f, 0.05f, p.F0_min, p.F0_max, p.w0_min, p.w0_max, 64.f, 1u, false);
+
+        for (unsigned resolution : {1024u, 4096u, 16384u}) {
+
+            if (resolution > largest_resolution) {continue;}
+
+            string image = p.name + ", " + str(resolution) + "x" + str(resolution);
+
+            grid_2D<float> synthesis;
+            double spectral_time = 1e-9*harness.run("spectral_synthesis", image, [&]() {
+                synthesis.clear();
+                synthesis = noise->spectral_synthesis(resolution, 1.f, 1u, pool);
+                return synthesis[0];
+            }).median;
+
+            double mean = 0.0;
+            double second_moment = 0.0;
+            for (size_t k=0 ; k<synthesis.size() ; k++) {
+                mean += synthesis[k];
+                second_moment += double(synthesis[k])*synthesis[k];
+            }
+            mean /= synthesis.size();
+            double spectral_variance = second_moment/synthesis.size() - mean*mean;
+            synthesis.clear();
+
+            //band of rows of the sparse convolution, whole image at 1k
+            unsigned rows = min(resolution, 1024u*1024u/resolution);
+            vector<float> band(size_t(resolution)*rows);
+            unsigned tile_rows = max(1u, rows/(4*pool.size()));
+            unsigned number_of_tiles = (rows + tile_rows - 1)/tile_rows;
+
+            double band_time = 1e-9*harness.run("sparse_convolution", image + ", " + str(rows) + " rows", [&]() {
+                pool.run(number_of_tiles, [&](size_t t) {
+                    unsigned y_begin = unsigned(t)*tile_rows;
+                    unsigned height = min(tile_rows, rows - y_begin);
+                    noise->evaluate_tile(0.f, float(y_begin), resolution, height, 1.f, band.data() + size_t(y_begin)*resolution);
+                });
+                return band[0];
+            }).median;
+            double sparse_time = band_time*double(resolution)/double(rows);
+
+            cout<<p.name<<" "<<resolution<<"x"<<resolution<<": spectral "<<spectral_time<<" s, sparse "<<sparse_time<<" s"<<(rows < resolution ? " (extrapolated)" : "")
+                <<", speedup "<<sparse_time/spectral_time<<", variance "<<spectral_variance<<" (expected "<<noise->variance()<<")"<<endl;
+
+        }
+
+    }
+
+    harness.report(json_file);
+
+    return 0;
+
+}
@@ -0,0 +1,75 @@
+#include <iostream>
+#include <fstream>
+#include <iterator>
+#include <vector>
+#include "vcl/vcl.hpp"
+#include "Noise.h"
+#include "Band_renderer.h"
+#include "Benchmark_harness.h"
+
+using namespace std;
+using namespace vcl;
+
+//noise image rendered band by band to a pgm file: throughput and memory of the bands against the whole image,
+//then the same render cancelled halfway and resumed from its checkpoint, which has to give the same file
+//usage: streaming_render_benchmark [number_of_threads] [resolution] [folder] [json_file] (run from Code/project/build or a sibling folder)
+
+vector<char> file_content (string file_name) {
+    ifstream file(file_name, ios::binary);
+    return vector<char>(istreambuf_iterator<char>(file), istreambuf_iterator<char>());
+}
+
+int main(int argc, char** argv) {
+
+    unsigned number_of_threads = argc > 1 ? unsigned(atoi(argv[1])) : 0;
+    unsigned resolution = argc > 2 ? unsigned(atoi(argv[2])) : 2048;
+    string folder = argc > 3 ? argv[3] : "../output/";
+    string json_file = argc > 4 ? argv[4] : folder + "streaming_render_benchmark.json";
+
+    thread_pool pool(number_of_threads);
+    cout<<"threads: "<<pool.size()<<", image: "<<resolution<<"x"<<resolution<<endl;
+
+    Noise noise(1.f, 0.05f, 0.125f, 0.125f, 0.f, 2*pi, 64.f, 1u, false);
+    float scale = 6.f*sqrt(noise.variance());
+    float origin = 0.5f - float(resolution)/2.f;
+
+    auto render_tile = [&](unsigned x_begin, unsigned y_begin, unsigned width, unsigned height, float* out) {
+        noise.evaluate_tile(origin + float(x_begin), origin + float(y_begin), width, height, 1.f, out);
+    };
+    auto color = [&](float noise_intensity) {
+        return 0.5f + noise_intensity/scale;
+    };
+
+    Band_renderer renderer(pool, 64);
+    string whole = folder + "streamed_whole.pgm";
+    string resumed = folder + "streamed_resumed.pgm";
+    remove((resumed + ".checkpoint").c_str());
+
+    //rendered twice, the first time as a warm up
+    Benchmark_harness::Settings settings = Benchmark_harness::long_runs(1);
+    settings.pin_to_core = false;
+    Benchmark_harness harness("streaming_render", settings);
+
+    bool saved = false;
+    double time = 1e-9*harness.run("Band_renderer", "pgm " + str(resolution) + "x" + str(resolution), [&]() {
+        saved = renderer.render(whole, resolution, resolution, Band_format::pgm, "benchmark", render_tile, color);
+        return saved;
+    }).median;
+
+    //cancelled once the first half of the rows is rendered, then run again
+    Cancellation_token cancellation;
+    renderer.render(resumed, resolution, resolution, Band_format::pgm, "benchmark", [&](unsigned x_begin, unsigned y_begin, unsigned width, unsigned height, float* out) {
+        render_tile(x_begin, y_begin, width, height, out);
+        if (y_begin + height >= resolution/2) {cancellation.cancel();}
+    }, color, &cancellation);
+    vector<char> interrupted = file_content(resumed);
+    renderer.render(resumed, resolution, resolution, Band_format::pgm, "benchmark", render_tile, color);
+
+    cout<<"render: "<<time<<" s, "<<1e-6*double(resolution)*resolution/time<<" Mpixels/s"<<(saved ? "" : ", failed")<<endl;
+    cout<<"memory: "<<renderer.peak_band_memory(resolution, Band_format::pgm)/1024<<" kB of bands, "<<size_t(resolution)*resolution*12/1024<<" kB for a vector<Vec3f> image"<<endl;
+    cout<<"interrupted at "<<interrupted.size()<<" bytes, resumed file "<<(file_content(resumed) == file_content(whole) ? "identical" : "different")<<endl;
+    harness.report(json_file);
+
+    return 0;
+
+}
@@ -0,0 +1,68 @@
+#include <iostream>
+#include <vector>
+#include "vcl/vcl.hpp"
+#include "Surface_noise.h"
+#include "Benchmark_harness.h"
+
+using namespace std;
+using namespace vcl;
+
+//cost per vertex of the surface noise on man.obj, as in update_surface_noise:
+//intensity() generates the 27 cells around each vertex, evaluate_mesh generates each cell once for the whole mesh
+//intensity() is timed on the first vertices only and compared with evaluate_mesh on the same vertices
+//usage: surface_noise_benchmark [number_of_threads] [number_of_vertices_for_intensity] [json_file] (run from Code/project/build or a sibling folder)
+
+int main(int argc, char** argv) {
+
+    unsigned number_of_threads = argc > 1 ? unsigned(atoi(argv[1])) : 0;
+    size_t sampled_vertices = argc > 2 ? size_t(atoi(argv[2])) : 2000;
+    string json_file = argc > 3 ? argv[3] : "../output/surface_noise_benchmark.json";
+
+    thread_pool pool(number_of_threads);
+
+    mesh shape = mesh_load_file_obj("../assets/man.obj");
+    float const scaling = 0.005f;
+    for(auto& p: shape.position) p *= scaling;
+    size_t number_of_vertices = shape.position.size();
+    sampled_vertices = min(sampled_vertices, number_of_vertices);
+
+    cout<<"threads: "<<pool.size()<<", vertices: "<<number_of_vertices<<endl;
+
+    Surface_noise surface_noise = Surface_noise(1.f, 0.05f, 0.125f, 64.f, 1u, false);
+
+    Benchmark_harness::Settings settings = Benchmark_harness::long_runs(5);
+    settings.pin_to_core = false;
+    Benchmark_harness harness("surface_noise", settings);
+
+    //per vertex, on the sampled vertices
+    vector<float> reference(sampled_vertices);
+    double intensity_time = 1e-9*harness.run("intensity", str(sampled_vertices) + " vertices of man.obj", [&]() {
+        pool.run(sampled_vertices, [&](size_t v) {
+            vec3 p = shape.position[v];
+            reference[v] = surface_noise.intensity(500*p[0], 500*p[1], 500*p[2], shape.normal[v]);
+        });
+        return reference[0];
+    }).median;
+
+    //whole mesh
+    buffer<float> intensities;
+    double mesh_time = 1e-9*harness.run("evaluate_mesh", str(number_of_vertices) + " vertices of man.obj", [&]() {
+        surface_noise.evaluate_mesh(shape, intensities, pool, 500.f);
+        return intensities[0];
+    }).median;
+
+    float difference = 0.f;
+    float largest = 0.f;
+    for (size_t v=0 ; v<sampled_vertices ; v++) {
+        difference = max(difference, fabs(intensities[v] - reference[v]));
+        largest = max(largest, fabs(reference[v]));
+    }
+
+    cout<<"intensity: "<<1e3*intensity_time/sampled_vertices<<" ms per vertex ("<<sampled_vertices<<" vertices)"<<endl;
+    cout<<"evaluate_mesh: "<<1e3*mesh_time/number_of_vertices<<" ms per vertex, speedup "<<(intensity_time/sampled_vertices)/(mesh_time/number_of_vertices)<<endl;
+    cout<<"largest difference "<<difference<<" for values up to "<<largest<<endl;
+    harness.report(json_file);
+
+    return 0;
+
+}
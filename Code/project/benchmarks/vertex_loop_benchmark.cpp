@@ -0,0 +1,111 @@
+#include <iostream>
+#include <vector>
+#include "vcl/vcl.hpp"
+#include "Vertex_loops.h"
+#include "Benchmark_harness.h"
+
+using namespace std;
+using namespace vcl;
+
+//per vertex loops of update_2D_noise (height and colour of the 500x500 grid) and of update_surface_noise (colour of man.obj),
+//serial with find_color called three times per vertex as they were, then the loops of Vertex_loops.h on 1, 4, 16 and 32 threads
+//the intensities are random: the noise evaluation itself is timed by the other benchmarks
+//usage: vertex_loop_benchmark [runs] [json_file] (run from Code/project/build or a sibling folder)
+
+vector<Vec3f> color_scale = {Vec3f(1,0,0),Vec3f(0,0,1)};
+
+
+//intensity(i) of the vertex i
+template <typename Intensity>
+void serial_colour (size_t number_of_vertices, Intensity const& intensity, float scale, buffer<vec3>& color) {
+    for (size_t i=0 ; i<number_of_vertices ; i++) {
+        if (0.5f + intensity(i)/(scale) <= 0.f) {
+            float t = 0.f;
+            color[i][0] = find_color(color_scale, t)[0];
+            color[i][1] = find_color(color_scale, t)[1];
+            color[i][2] = find_color(color_scale, t)[2];
+        }
+        else if (0.5f + intensity(i)/(scale) >= 1.f) {
+            float t = 1.f;
+            color[i][0] = find_color(color_scale, t)[0];
+            color[i][1] = find_color(color_scale, t)[1];
+            color[i][2] = find_color(color_scale, t)[2];
+        }
+        else {
+            float t = 0.5f + intensity(i)/(scale);
+            color[i][0] = find_color(color_scale, t)[0];
+            color[i][1] = find_color(color_scale, t)[1];
+            color[i][2] = find_color(color_scale, t)[2];
+        }
+    }
+}
+
+
+int main(int argc, char** argv) {
+
+    Benchmark_harness::Settings settings;
+    settings.runs = argc > 1 ? unsigned(atoi(argv[1])) : 15;
+    settings.pin_to_core = false;
+    string json_file = argc > 2 ? argv[2] : "../output/vertex_loop_benchmark.json";
+    float const scale = 6.f;
+    size_t const grain_size = 4096; //vertex_grain_size of Main.cpp
+
+    //500x500 grid, the intensity tile is transposed as in update_2D_noise
+    int N = 500;
+    mesh grid = mesh_primitive_grid({-1,-1,0},{1,-1,0},{1,1,0},{-1,1,0},N,N);
+    vector<float> tile(size_t(N)*N);
+    for (float& v : tile) v = rand_interval(-5.f, 5.f);
+
+    mesh shape = mesh_load_file_obj("../assets/man.obj");
+    vector<float> intensities(shape.position.size());
+    for (float& v : intensities) v = rand_interval(-5.f, 5.f);
+
+    //the vertex k = j*N+i of the grid has the intensity tile[i*N+j]
+    auto grid_intensity = [&](size_t k) { return tile[(k%N)*N + k/N]; };
+    auto shape_intensity = [&](size_t k) { return intensities[k]; };
+
+    cout<<"grid: "<<grid.position.size()<<" vertices, man.obj: "<<shape.position.size()<<" vertices, "<<hardware_thread_count()<<" hardware threads"<<endl;
+
+    Benchmark_harness harness("vertex_loop", settings);
+
+    double grid_serial = harness.run("update_2D_noise", "500x500 grid, serial", [&]() {
+        for (int j=0 ; j<N ; j++) {
+            for (int i=0 ; i<N ; i++) {
+                grid.position[j*N+i][2] = 0.2f*tile[i*N+j]/(scale);
+            }
+        }
+        serial_colour(size_t(N)*N, grid_intensity, scale, grid.color);
+        return grid.color[0].x;
+    }).median;
+    double shape_serial = harness.run("update_surface_noise", "man.obj, serial", [&]() {
+        serial_colour(intensities.size(), shape_intensity, scale, shape.color);
+        return shape.color[0].x;
+    }).median;
+
+    cout<<"serial: grid "<<1e-6*grid_serial<<" ms, man.obj "<<1e-6*shape_serial<<" ms"<<endl;
+
+    for (unsigned threads : {1u, 4u, 16u, 32u}) {
+
+        thread_pool pool(threads);
+        string parameters = str(threads) + " threads";
+
+        double grid_time = harness.run("update_2D_noise", "500x500 grid, " + parameters, [&]() {
+            size_t number_of_vertices = size_t(N)*N;
+            displace_vertices(pool, number_of_vertices, grain_size, grid_intensity, 0.2f, scale, grid.position);
+            color_vertices(pool, number_of_vertices, grain_size, grid_intensity, scale, color_scale, grid.color);
+            return grid.color[0].x;
+        }).median;
+        double shape_time = harness.run("update_surface_noise", "man.obj, " + parameters, [&]() {
+            color_vertices(pool, intensities.size(), grain_size, shape_intensity, scale, color_scale, shape.color);
+            return shape.color[0].x;
+        }).median;
+
+        cout<<threads<<" threads: grid "<<1e-6*grid_time<<" ms (speedup "<<grid_serial/grid_time<<"), man.obj "<<1e-6*shape_time<<" ms (speedup "<<shape_serial/shape_time<<")"<<endl;
+
+    }
+
+    harness.report(json_file);
+
+    return 0;
+
+}
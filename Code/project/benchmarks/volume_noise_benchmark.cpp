@@ -0,0 +1,73 @@
+#include <iostream>
+#include <vector>
+#include "vcl/vcl.hpp"
+#include "Noise3D.h"
+#include "Benchmark_harness.h"
+
+using namespace std;
+using namespace vcl;
+
+//solid noise of a resolution^3 volume: evaluate_volume swept plane by plane against intensity() on sampled voxels,
+//then the same volume streamed to a raw file by save_volume; the sample variance is compared with variance()
+//usage: volume_noise_benchmark [number_of_threads] [resolution] [file] [json_file] (run from Code/project/build or a sibling folder)
+
+int main(int argc, char** argv) {
+
+    unsigned number_of_threads = argc > 1 ? unsigned(atoi(argv[1])) : 0;
+    unsigned resolution = argc > 2 ? unsigned(atoi(argv[2])) : 128;
+    string file_name = argc > 3 ? argv[3] : "../output/volume_noise.raw";
+    string json_file = argc > 4 ? argv[4] : "../output/volume_noise_benchmark.json";
+
+    thread_pool pool(number_of_threads);
+    cout<<"threads: "<<pool.size()<<", volume: "<<resolution<<"^3"<<endl;
+
+    Noise3D noise(1.f, 0.05f, 0.0625f, 0.125f, 64.f, 1u, false);
+    vec3 origin = {-100.f, -100.f, -100.f};
+    float step = 1.f;
+
+    Benchmark_harness::Settings settings = Benchmark_harness::long_runs();
+    settings.pin_to_core = false;
+    Benchmark_harness harness("volume_noise", settings);
+    string parameters = str(resolution) + "^3 voxels";
+
+    grid_3D<float> volume;
+    double volume_time = 1e-9*harness.run("evaluate_volume", parameters, [&]() {
+        volume = noise.evaluate_volume(resolution, resolution, resolution, origin, step, pool);
+        return volume.data[0];
+    }).median;
+
+    //intensity() on 2000 voxels, it generates the 27 cells of each of them
+    size_t samples = 2000;
+    float difference = 0.f;
+    double intensity_time = 1e-9*harness.run("intensity", str(samples) + " voxels", [&]() {
+        for (size_t s=0 ; s<samples ; s++) {
+            size_t px = (s*7919) % resolution, py = (s*104729) % resolution, pz = (s*1299709) % resolution;
+            float reference = noise.intensity(origin[0] + px*step, origin[1] + py*step, origin[2] + pz*step);
+            difference = max(difference, fabs(reference - volume(px, py, pz)));
+        }
+        return difference;
+    }).median;
+
+    double sum = 0.0, sum_of_squares = 0.0;
+    for (size_t v=0 ; v<volume.size() ; v++) {
+        sum += volume.data[v];
+        sum_of_squares += double(volume.data[v])*volume.data[v];
+    }
+    double mean = sum/volume.size();
+
+    bool saved = false;
+    double save_time = 1e-9*harness.run("save_volume", parameters, [&]() {
+        saved = noise.save_volume(file_name, resolution, resolution, resolution, origin, step, pool);
+        return saved;
+    }).median;
+
+    double voxels = double(volume.size());
+    cout<<"evaluate_volume: "<<volume_time<<" s, "<<1e-6*voxels/volume_time<<" Mvoxels/s"<<endl;
+    cout<<"intensity: "<<1e-6*samples/intensity_time<<" Mvoxels/s, speedup "<<(intensity_time/samples)/(volume_time/voxels)<<", largest difference "<<difference<<endl;
+    cout<<"save_volume: "<<save_time<<" s"<<(saved ? " to " + file_name : " failed")<<", memory: one plane of "<<resolution*resolution*sizeof(float)/1024<<" kB and 3 layers of cells"<<endl;
+    cout<<"variance: sampled "<<sum_of_squares/voxels - mean*mean<<", variance() "<<noise.variance()<<endl;
+    harness.report(json_file);
+
+    return 0;
+
+}
@@ -0,0 +1,236 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <vector>
+
+using namespace std;
+
+//globally adaptive quadrature: the 15 points Kronrod rule gives the integral of each interval and its difference with the embedded
+//7 points Gauss rule the error, the 17 points degree 7 rule of Genz and Malik and its embedded degree 5 rule do the same on rectangles;
+//the interval with the largest error is bisected until the summed error is below tolerance*|integral|, or until the maximum number of bisections is reached
+//smooth integrands are done with one interval, narrow peaks are refined where they are
+//a peak narrower than the spacing of the 15 points can be missed by all of them, with a small error: the domain is then
+//first split into pieces of the width of the peaks
+
+class Adaptive_quadrature {
+
+    public:
+
+        Adaptive_quadrature (double tolerance, unsigned max_bisections=200)
+        :  m_tolerance(tolerance), m_max_bisections(max_bisections), m_evaluations(0)
+        {}
+
+
+        //integral of f(x) over [a,b], split into pieces equal intervals first
+        template <typename Function>
+        double integrate (Function const& f, double a, double b, unsigned pieces=1) {
+
+            pieces = max(pieces, 1u);
+            vector<Interval> intervals;
+            for (unsigned k=0 ; k<pieces ; k++) {
+                intervals.push_back(kronrod(f, a + (b - a)*double(k)/double(pieces), a + (b - a)*double(k+1)/double(pieces)));
+            }
+            return refine(intervals, [&](Interval const& interval, vector<Interval>& halves) {
+                double middle = 0.5*(interval.x_min + interval.x_max);
+                halves.push_back(kronrod(f, interval.x_min, middle));
+                halves.push_back(kronrod(f, middle, interval.x_max));
+            });
+
+        }
+
+
+        //integral of f(x,y) over [x_min,x_max]x[y_min,y_max], split into x_pieces x y_pieces equal rectangles first
+        //the rectangles are bisected along the direction where the fourth difference of f is the largest
+        template <typename Function>
+        double integrate (Function const& f, double x_min, double x_max, double y_min, double y_max, unsigned x_pieces=1, unsigned y_pieces=1) {
+
+            x_pieces = max(x_pieces, 1u);
+            y_pieces = max(y_pieces, 1u);
+            vector<Interval> rectangles;
+            for (unsigned j=0 ; j<y_pieces ; j++) {
+                for (unsigned i=0 ; i<x_pieces ; i++) {
+                    rectangles.push_back(genz_malik(f, x_min + (x_max - x_min)*double(i)/double(x_pieces), x_min + (x_max - x_min)*double(i+1)/double(x_pieces),
+                                                    y_min + (y_max - y_min)*double(j)/double(y_pieces), y_min + (y_max - y_min)*double(j+1)/double(y_pieces)));
+                }
+            }
+            return refine(rectangles, [&](Interval const& rectangle, vector<Interval>& halves) {
+                if (rectangle.x_error >= rectangle.y_error) {
+                    double middle = 0.5*(rectangle.x_min + rectangle.x_max);
+                    halves.push_back(genz_malik(f, rectangle.x_min, middle, rectangle.y_min, rectangle.y_max));
+                    halves.push_back(genz_malik(f, middle, rectangle.x_max, rectangle.y_min, rectangle.y_max));
+                }
+                else {
+                    double middle = 0.5*(rectangle.y_min + rectangle.y_max);
+                    halves.push_back(genz_malik(f, rectangle.x_min, rectangle.x_max, rectangle.y_min, middle));
+                    halves.push_back(genz_malik(f, rectangle.x_min, rectangle.x_max, middle, rectangle.y_max));
+                }
+            });
+
+        }
+
+
+        //number of evaluations of the integrands since the construction
+        size_t evaluations () const {
+            return m_evaluations;
+        }
+
+
+    private:
+
+        struct Interval {
+            double x_min, x_max, y_min, y_max;
+            double integral;
+            double error;
+            double x_error; // fourth differences along x and y, for the rectangles
+            double y_error;
+        };
+
+
+        //abscissas of the Kronrod rule on [-1,1], the odd ones are the Gauss abscissas, symmetric around 0
+        static double node (int k) {
+            static double const nodes[8] = {0.991455371120812639, 0.949107912342758525, 0.864864423359769073, 0.741531185599394440,
+                                            0.586087235467691130, 0.405845151377397167, 0.207784955007898468, 0.0};
+            return nodes[k];
+        }
+
+        static double kronrod_weight (int k) {
+            static double const weights[8] = {0.022935322010529225, 0.063092092629978553, 0.104790010322250184, 0.140653259715525919,
+                                              0.169004726639267903, 0.190350578064785410, 0.204432940075298892, 0.209482141084727828};
+            return weights[k];
+        }
+
+        //0 on the Kronrod only abscissas
+        static double gauss_weight (int k) {
+            static double const weights[8] = {0.0, 0.129484966168869693, 0.0, 0.279705391489276668,
+                                              0.0, 0.381830050505118945, 0.0, 0.417959183673469388};
+            return weights[k];
+        }
+
+        //the 15 abscissas and their weights, from -1 to 1
+        static void rule (double* x, double* kronrod, double* gauss) {
+            for (int k=0 ; k<8 ; k++) {
+                x[k] = -node(k);
+                x[14-k] = node(k);
+                kronrod[k] = kronrod[14-k] = kronrod_weight(k);
+                gauss[k] = gauss[14-k] = gauss_weight(k);
+            }
+        }
+
+
+        template <typename Function>
+        Interval kronrod (Function const& f, double a, double b) {
+
+            double x[15], kronrod_weights[15], gauss_weights[15];
+            rule(x, kronrod_weights, gauss_weights);
+
+            double center = 0.5*(a + b);
+            double half_length = 0.5*(b - a);
+
+            double kronrod_sum = 0.0;
+            double gauss_sum = 0.0;
+            for (int k=0 ; k<15 ; k++) {
+                double value = f(center + half_length*x[k]);
+                kronrod_sum += kronrod_weights[k]*value;
+                gauss_sum += gauss_weights[k]*value;
+            }
+            m_evaluations += 15;
+
+            Interval interval = {a, b, 0.0, 0.0, kronrod_sum*half_length, fabs(kronrod_sum - gauss_sum)*half_length, 0.0, 0.0};
+            return interval;
+
+        }
+
+
+        //Genz and Malik, "An adaptive algorithm for numerical integration over an n-dimensional rectangular region", 1980, with n = 2
+        template <typename Function>
+        Interval genz_malik (Function const& f, double x_min, double x_max, double y_min, double y_max) {
+
+            double const lambda2 = sqrt(9.0/70.0);
+            double const lambda3 = sqrt(9.0/10.0);
+            double const lambda4 = sqrt(9.0/10.0);
+            double const lambda5 = sqrt(9.0/19.0);
+
+            double x_center = 0.5*(x_min + x_max);
+            double x_half_length = 0.5*(x_max - x_min);
+            double y_center = 0.5*(y_min + y_max);
+            double y_half_length = 0.5*(y_max - y_min);
+            auto value = [&](double u, double v) {
+                return f(x_center + x_half_length*u, y_center + y_half_length*v);
+            };
+
+            double center = value(0.0, 0.0);
+            double x2 = value(-lambda2, 0.0) + value(lambda2, 0.0);
+            double y2 = value(0.0, -lambda2) + value(0.0, lambda2);
+            double x3 = value(-lambda3, 0.0) + value(lambda3, 0.0);
+            double y3 = value(0.0, -lambda3) + value(0.0, lambda3);
+            double sum4 = value(-lambda4, -lambda4) + value(lambda4, -lambda4) + value(-lambda4, lambda4) + value(lambda4, lambda4);
+            double sum5 = value(-lambda5, -lambda5) + value(lambda5, -lambda5) + value(-lambda5, lambda5) + value(lambda5, lambda5);
+            m_evaluations += 17;
+
+            //weights relative to the area
+            double degree_7 = (-3816.0*center + 2940.0*(x2 + y2) + 1020.0*(x3 + y3) + 200.0*sum4 + 6859.0/4.0*sum5)/19683.0;
+            double degree_5 = (-971.0*center/729.0 + 245.0/486.0*(x2 + y2) + 65.0/1458.0*(x3 + y3) + 25.0/729.0*sum4);
+
+            double area = 4.0*x_half_length*y_half_length;
+            double x_difference = fabs(x2 - 2.0*center - (x3 - 2.0*center)/7.0);
+            double y_difference = fabs(y2 - 2.0*center - (y3 - 2.0*center)/7.0);
+            Interval rectangle = {x_min, x_max, y_min, y_max, degree_7*area, fabs(degree_7 - degree_5)*area, x_difference, y_difference};
+            return rectangle;
+
+        }
+
+
+        //bisects the interval of largest error until the tolerance is met, split(interval, halves) appends its two halves
+        template <typename Split>
+        double refine (vector<Interval>& intervals, Split const& split) {
+
+            auto smaller_error = [](Interval const& a, Interval const& b) { return a.error < b.error; };
+
+            make_heap(intervals.begin(), intervals.end(), smaller_error);
+
+            double integral = 0.0;
+            double error = 0.0;
+            for (Interval const& interval : intervals) {
+                integral += interval.integral;
+                error += interval.error;
+            }
+
+            vector<Interval> halves;
+            unsigned bisections = 0;
+
+            while (error > max(m_tolerance*fabs(integral), numeric_limits<double>::min()) && bisections < m_max_bisections) {
+
+                bisections++;
+
+                pop_heap(intervals.begin(), intervals.end(), smaller_error);
+                Interval worst = intervals.back();
+                intervals.pop_back();
+
+                halves.clear();
+                split(worst, halves);
+
+                integral += halves[0].integral + halves[1].integral - worst.integral;
+                error += halves[0].error + halves[1].error - worst.error;
+                for (Interval const& half : halves) {
+                    intervals.push_back(half);
+                    push_heap(intervals.begin(), intervals.end(), smaller_error);
+                }
+
+            }
+
+            //the running sums accumulate rounding errors, the final result is summed again
+            integral = 0.0;
+            for (Interval const& interval : intervals) {
+                integral += interval.integral;
+            }
+            return integral;
+
+        }
+
+        double m_tolerance;
+        unsigned m_max_bisections;
+        size_t m_evaluations;
+
+};
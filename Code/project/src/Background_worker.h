@@ -0,0 +1,89 @@
+#pragma once
+
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+using namespace std;
+
+//runs jobs one at a time on a background thread, so that the render loop never waits for them
+//only the latest job is kept: a job submitted while another one is pending replaces it instead of queuing behind it,
+//the job already running is not interrupted
+
+class Background_worker {
+
+    public:
+
+        Background_worker ()
+        :  m_has_pending_job(false), m_running(false), m_stop(false)
+        {
+            m_thread = thread(&Background_worker::work, this);
+        }
+
+
+        ~Background_worker () {
+            {
+                lock_guard<mutex> lock(m_access);
+                m_stop = true;
+            }
+            m_job_available.notify_one();
+            m_thread.join();
+        }
+
+
+        Background_worker (Background_worker const&) = delete;
+        Background_worker& operator= (Background_worker const&) = delete;
+
+
+        void submit (function<void()> job) {
+            {
+                lock_guard<mutex> lock(m_access);
+                m_pending_job = move(job);
+                m_has_pending_job = true;
+            }
+            m_job_available.notify_one();
+        }
+
+
+        //a job is running or waiting to run
+        bool busy () {
+            lock_guard<mutex> lock(m_access);
+            return m_running || m_has_pending_job;
+        }
+
+
+    private:
+
+        void work () {
+
+            unique_lock<mutex> lock(m_access);
+
+            while (true) {
+
+                m_job_available.wait(lock, [this]() { return m_stop || m_has_pending_job; });
+                if (m_stop) {return;}
+
+                function<void()> job = move(m_pending_job);
+                m_has_pending_job = false;
+                m_running = true;
+
+                lock.unlock();
+                job();
+                lock.lock();
+
+                m_running = false;
+
+            }
+
+        }
+
+        thread m_thread;
+        mutex m_access;
+        condition_variable m_job_available;
+        function<void()> m_pending_job;
+        bool m_has_pending_job;
+        bool m_running;
+        bool m_stop;
+
+};
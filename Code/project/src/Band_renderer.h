@@ -0,0 +1,227 @@
+#pragma once
+
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <cstdio>
+#include <thread>
+#include <vector>
+#include "vcl/vcl.hpp"
+#include "Bounded_queue.h"
+#include "Cancellation_token.h"
+#include "Tile_renderer.h"
+
+using namespace std;
+using namespace vcl;
+
+enum class Band_format { ppm, pgm, raw_float };
+
+//renders an image too large for the memory in horizontal bands of rows, written to the file as they are done:
+//each band is split into square tiles of its height rendered in parallel by the pool while a writer thread empties a bounded queue of encoded bands into the file,
+//so that at most queue_capacity + 1 bands are in memory whatever the size of the image
+//after each band written, the number of bands in the file is saved to file_name.checkpoint: a render interrupted
+//(killed, or cancelled between two bands) starts again from there when it is run with the same file, size, format and key
+//ppm and pgm are 8 bits black and white images of color(value) in [0,1], raw_float the values as 32 bits floats in the byte order of the machine
+
+class Band_renderer {
+
+    public:
+
+        Band_renderer (thread_pool& pool, unsigned band_height=64, unsigned queue_capacity=2)
+        :  m_pool(pool), m_band_height(band_height == 0 ? 1 : band_height), m_queue_capacity(queue_capacity)
+        {}
+
+
+        //render_tile(x_begin, y_begin, tile_width, tile_height, out) fills out[py*tile_width + px] with the value of the pixel (x_begin + px, y_begin + py),
+        //color(value) maps it to [0,1] for ppm and pgm; key identifies what is rendered (the parameters of the noise), a checkpoint of another key is not resumed
+        //returns false if the file cannot be written or the render was cancelled, the checkpoint is then kept
+        template <typename Render_tile, typename Color>
+        bool render (string file_name, unsigned width, unsigned height, Band_format format, string key,
+                     Render_tile const& render_tile, Color const& color, Cancellation_token const* cancellation = nullptr) const {
+
+            unsigned number_of_bands = (height + m_band_height - 1)/m_band_height;
+            string header = file_header(width, height, format);
+            size_t row_bytes = size_t(width)*bytes_per_pixel(format);
+            string description = checkpoint_description(width, height, format, key);
+
+            unsigned first_band = read_checkpoint(file_name, description);
+            fstream file;
+            if (first_band > 0) {
+                file.open(file_name, ios::in | ios::out | ios::binary);
+            }
+            if (!file.is_open()) {
+                first_band = 0;
+                file.open(file_name, ios::out | ios::binary | ios::trunc);
+                file.write(header.data(), header.size());
+            }
+            if (!file) {
+                cout<<"cannot write the image "<<file_name<<endl;
+                return false;
+            }
+            if (first_band > 0) {
+                cout<<file_name<<" resumed at band "<<first_band<<" of "<<number_of_bands<<endl;
+            }
+
+            struct Encoded_band {
+                unsigned index;
+                vector<unsigned char> bytes;
+            };
+            Bounded_queue<Encoded_band> queue(m_queue_capacity);
+
+            bool written = true;
+            bool checkpointed = true;
+            thread writer([&]() {
+                Encoded_band band;
+                while (queue.pop(band)) {
+                    if (!written) {continue;}
+                    file.seekp(streamoff(header.size() + size_t(band.index)*m_band_height*row_bytes));
+                    file.write(reinterpret_cast<char const*>(band.bytes.data()), band.bytes.size());
+                    file.flush();
+                    written = bool(file);
+                    //the image stays right without the checkpoint, an interrupted render would only resume from an earlier band
+                    if (written && !write_checkpoint(file_name, description, band.index + 1) && checkpointed) {
+                        cout<<"cannot update the checkpoint "<<file_name<<".checkpoint, the render goes on without it"<<endl;
+                        checkpointed = false;
+                    }
+                }
+            });
+
+            vector<float> values;
+            bool cancelled = false;
+            for (unsigned b=first_band ; b<number_of_bands ; b++) {
+
+                if (cancellation && cancellation->cancelled()) {
+                    cancelled = true;
+                    break;
+                }
+
+                unsigned row_begin = b*m_band_height;
+                unsigned number_of_rows = min(m_band_height, height - row_begin);
+                values.resize(size_t(width)*number_of_rows);
+                Tile_renderer(m_pool, m_band_height).render(width, number_of_rows, [&](unsigned x_begin, unsigned y_begin, unsigned tile_width, unsigned tile_height) {
+                    vector<float> tile(size_t(tile_width)*tile_height);
+                    render_tile(x_begin, row_begin + y_begin, tile_width, tile_height, tile.data());
+                    for (unsigned py=0 ; py<tile_height ; py++) {
+                        copy(tile.begin() + size_t(py)*tile_width, tile.begin() + size_t(py+1)*tile_width, values.begin() + size_t(y_begin + py)*width + x_begin);
+                    }
+                });
+
+                Encoded_band band;
+                band.index = b;
+                encode(values, format, color, band.bytes);
+                queue.push(move(band));
+
+            }
+
+            queue.close();
+            writer.join();
+            file.close();
+
+            if (!written) {
+                cout<<"cannot write the image "<<file_name<<endl;
+                return false;
+            }
+            if (cancelled) {
+                return false;
+            }
+
+            remove((file_name + ".checkpoint").c_str());
+            remove((file_name + ".checkpoint.tmp").c_str());
+            return true;
+
+        }
+
+
+        unsigned band_height () const {
+            return m_band_height;
+        }
+
+
+        //bytes in memory for the bands of an image of this width: the one being rendered, the one being written and the queued ones
+        size_t peak_band_memory (unsigned width, Band_format format) const {
+            size_t rendered = size_t(width)*m_band_height*(sizeof(float) + bytes_per_pixel(format));
+            size_t encoded = size_t(width)*m_band_height*bytes_per_pixel(format);
+            return rendered + (m_queue_capacity + 1)*encoded;
+        }
+
+
+    private:
+
+        static size_t bytes_per_pixel (Band_format format) {
+            if (format == Band_format::ppm) {return 3;}
+            if (format == Band_format::pgm) {return 1;}
+            return sizeof(float);
+        }
+
+
+        static string file_header (unsigned width, unsigned height, Band_format format) {
+            stringstream header;
+            if (format == Band_format::ppm) {header<<"P6\n"<<width<<" "<<height<<"\n255\n";}
+            if (format == Band_format::pgm) {header<<"P5\n"<<width<<" "<<height<<"\n255\n";}
+            return header.str();
+        }
+
+
+        //grey levels truncated as in black_and_white (Main.cpp)
+        template <typename Color>
+        static void encode (vector<float> const& values, Band_format format, Color const& color, vector<unsigned char>& bytes) {
+
+            if (format == Band_format::raw_float) {
+                bytes.resize(values.size()*sizeof(float));
+                copy(reinterpret_cast<unsigned char const*>(values.data()), reinterpret_cast<unsigned char const*>(values.data()) + bytes.size(), bytes.begin());
+                return;
+            }
+
+            size_t channels = bytes_per_pixel(format);
+            bytes.resize(values.size()*channels);
+            for (size_t k=0 ; k<values.size() ; k++) {
+                unsigned char grey = static_cast<unsigned char>(min(max(color(values[k]), 0.f), 1.f)*255.f);
+                for (size_t c=0 ; c<channels ; c++) {
+                    bytes[k*channels + c] = grey;
+                }
+            }
+
+        }
+
+
+        string checkpoint_description (unsigned width, unsigned height, Band_format format, string const& key) const {
+            stringstream description;
+            description<<width<<" "<<height<<" "<<int(format)<<" "<<m_band_height<<" "<<key;
+            return description.str();
+        }
+
+
+        //number of bands already in the file, 0 without a checkpoint of this description
+        //without file_name.checkpoint, the render may have been interrupted while write_checkpoint replaced it: the new one is then whole
+        static unsigned read_checkpoint (string const& file_name, string const& description) {
+            ifstream checkpoint(file_name + ".checkpoint");
+            if (!checkpoint.is_open()) {checkpoint.open(file_name + ".checkpoint.tmp");}
+            string saved_description;
+            unsigned bands = 0;
+            if (!getline(checkpoint, saved_description) || saved_description != description || !(checkpoint>>bands)) {
+                return 0;
+            }
+            return bands;
+        }
+
+
+        //written next to the image then renamed over the previous checkpoint, so that an interruption leaves one of them whole
+        //rename does not replace an existing file on windows, the previous checkpoint is removed first there
+        static bool write_checkpoint (string const& file_name, string const& description, unsigned bands) {
+            string checkpoint_name = file_name + ".checkpoint";
+            ofstream checkpoint(checkpoint_name + ".tmp");
+            checkpoint<<description<<"\n"<<bands<<"\n";
+            checkpoint.close();
+            if (!checkpoint) {return false;}
+#ifdef _WIN32
+            remove(checkpoint_name.c_str());
+#endif
+            return rename((checkpoint_name + ".tmp").c_str(), checkpoint_name.c_str()) == 0;
+        }
+
+
+        thread_pool& m_pool;
+        unsigned m_band_height;
+        unsigned m_queue_capacity;
+
+};
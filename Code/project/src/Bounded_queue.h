@@ -0,0 +1,68 @@
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+
+using namespace std;
+
+//queue of at most capacity items between producer and consumer threads:
+//push waits while it is full, so that a fast producer cannot run ahead of the consumer by more than capacity items,
+//pop waits while it is empty and returns false once the queue is closed and empty
+
+template <typename T>
+class Bounded_queue {
+
+    public:
+
+        Bounded_queue (size_t capacity)
+        :  m_capacity(capacity == 0 ? 1 : capacity), m_closed(false)
+        {}
+
+
+        Bounded_queue (Bounded_queue const&) = delete;
+        Bounded_queue& operator= (Bounded_queue const&) = delete;
+
+
+        void push (T item) {
+            unique_lock<mutex> lock(m_access);
+            m_not_full.wait(lock, [this]() { return m_items.size() < m_capacity; });
+            m_items.push_back(move(item));
+            m_not_empty.notify_one();
+        }
+
+
+        bool pop (T& item) {
+            unique_lock<mutex> lock(m_access);
+            m_not_empty.wait(lock, [this]() { return m_closed || !m_items.empty(); });
+            if (m_items.empty()) {return false;}
+            item = move(m_items.front());
+            m_items.pop_front();
+            m_not_full.notify_one();
+            return true;
+        }
+
+
+        //no more items will be pushed, pop returns false once the remaining ones are taken
+        void close () {
+            lock_guard<mutex> lock(m_access);
+            m_closed = true;
+            m_not_empty.notify_all();
+        }
+
+
+        size_t capacity () const {
+            return m_capacity;
+        }
+
+
+    private:
+
+        size_t m_capacity;
+        bool m_closed;
+        deque<T> m_items;
+        mutex m_access;
+        condition_variable m_not_full;
+        condition_variable m_not_empty;
+
+};
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <atomic>
+
+using namespace std;
+
+//cooperative cancellation of a long evaluation: the owner calls cancel(), the evaluation checks cancelled()
+//before each tile or row and gives up early, leaving its output incomplete
+
+class Cancellation_token {
+
+    public:
+
+        Cancellation_token ()
+        :  m_cancelled(false)
+        {}
+
+
+        void cancel () {
+            m_cancelled = true;
+        }
+
+
+        bool cancelled () const {
+            return m_cancelled;
+        }
+
+
+    private:
+
+        atomic<bool> m_cancelled;
+
+};
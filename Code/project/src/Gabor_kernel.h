@@ -0,0 +1,339 @@
+#pragma once
+
+#include <cmath>
+#include <cstring>
+#include "vcl/vcl.hpp"
+#include "Impulse_list.h"
+#include "Noise_counters.h"
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define GABOR_KERNEL_X86
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#define GABOR_KERNEL_AVX2
+#else
+#define GABOR_KERNEL_AVX2 __attribute__((target("avx2,fma")))
+#endif
+#endif
+
+using namespace std;
+using namespace vcl;
+
+//Vectorized evaluation of the sum of the Gabor kernels of a cell at one point:
+//  sum_i wi*K*exp(-pi*a^2*|d_i|^2)*cos(hx_i*d_i.x + hy_i*d_i.y), d_i = (x-xi, y-yi)*kernel_radius, only for |(x-xi, y-yi)| < 1
+//with (hx_i,hy_i) = 2*pi*F0i*(cos(w0i),sin(w0i)) precomputed once per impulse (Impulse_list::compute_harmonics).
+//
+//The exp and cos calls are replaced by polynomial approximations, evaluated on 8 (AVX2+FMA) or 4 (SSE2) impulses at once.
+//The instruction set is chosen at runtime, with a scalar fallback using the same polynomials.
+//
+//Maximum errors, measured against double precision libm (exp on [-pi,0] since |d|<kernel_radius=1/a, cos on [-10^4,10^4]):
+//  accurate : exp relative error < 1e-7, cos absolute error < 2e-7
+//  fast     : exp relative error < 6e-5, cos absolute error < 2.5e-5
+//The radius test is done in float instead of double, so an impulse lying within one ulp of the kernel radius
+//may be kept or dropped differently than by the exact path (a jump of at most K*exp(-pi) on a few isolated samples).
+//Kernel_accuracy::exact keeps the original libm evaluation (Noise::gabor), bit-identical to the previous results.
+
+enum class Kernel_accuracy { exact, accurate, fast };
+
+enum class Kernel_isa { scalar, sse, avx2 };
+
+
+
+//polynomial coefficients, Taylor expansions on the reduced ranges [-ln2/2,ln2/2] (exp) and [-pi/2,pi/2] (cos)
+
+const float gabor_exp_coefficients[8] = {1.f, 1.f, 1.f/2.f, 1.f/6.f, 1.f/24.f, 1.f/120.f, 1.f/720.f, 1.f/5040.f};
+const float gabor_cos_coefficients[7] = {1.f, -1.f/2.f, 1.f/24.f, -1.f/720.f, 1.f/40320.f, -1.f/3628800.f, 1.f/479001600.f};
+
+//highest used coefficient for each accuracy
+inline int gabor_exp_degree (Kernel_accuracy accuracy) { return accuracy == Kernel_accuracy::fast ? 4 : 7; }
+inline int gabor_cos_degree (Kernel_accuracy accuracy) { return accuracy == Kernel_accuracy::fast ? 4 : 6; }
+
+const float gabor_ln2_hi = 0.693359375f;
+const float gabor_ln2_lo = -2.12194440e-4f;
+const float gabor_log2e = 1.44269504089f;
+const float gabor_inv_pi = 0.318309886184f;
+const float gabor_pi_1 = 3.140625f;
+const float gabor_pi_2 = 9.67502593994140625e-4f;
+const float gabor_pi_3 = 1.509957990977e-7f;
+
+
+
+inline float gabor_exp_approximation (float x, Kernel_accuracy accuracy) {
+
+    x = fmax(x, -87.f);
+    float n = nearbyint(x*gabor_log2e);
+    float r = (x - n*gabor_ln2_hi) - n*gabor_ln2_lo;
+
+    int degree = gabor_exp_degree(accuracy);
+    float p = gabor_exp_coefficients[degree];
+    for (int k=degree-1 ; k>=0 ; k--) {
+        p = p*r + gabor_exp_coefficients[k];
+    }
+
+    int bits = (int(n) + 127) << 23;
+    float scale;
+    memcpy(&scale, &bits, sizeof(float));
+    return p*scale;
+
+}
+
+
+inline float gabor_cos_approximation (float x, Kernel_accuracy accuracy) {
+
+    float q = nearbyint(x*gabor_inv_pi);
+    float r = ((x - q*gabor_pi_1) - q*gabor_pi_2) - q*gabor_pi_3;
+    float z = r*r;
+
+    int degree = gabor_cos_degree(accuracy);
+    float p = gabor_cos_coefficients[degree];
+    for (int k=degree-1 ; k>=0 ; k--) {
+        p = p*z + gabor_cos_coefficients[k];
+    }
+
+    return (long(q) & 1) ? -p : p;
+
+}
+
+
+//sum of the kernels for impulses [begin,end) with the scalar approximations
+inline float gabor_kernel_sum_scalar (Kernel_accuracy accuracy, float exp_factor, float kernel_radius, float x, float y, Impulse_list const& impulses, size_t begin, size_t end) {
+
+    float noise = 0.f;
+    for (size_t i=begin ; i<end ; i++) {
+
+        float ux = x - impulses.x[i];
+        float uy = y - impulses.y[i];
+
+        if (ux*ux + uy*uy < 1.f) {
+            float dx = ux*kernel_radius;
+            float dy = uy*kernel_radius;
+            float gaussian = gabor_exp_approximation(exp_factor*(dx*dx + dy*dy), accuracy);
+            float harmonic = gabor_cos_approximation(impulses.harmonic_x[i]*dx + impulses.harmonic_y[i]*dy, accuracy);
+            noise += impulses.weight[i]*gaussian*harmonic;
+        }
+
+    }
+
+    return noise;
+
+}
+
+
+
+#ifdef GABOR_KERNEL_X86
+
+inline __m128 gabor_exp_sse (__m128 x, int degree) {
+
+    x = _mm_max_ps(x, _mm_set1_ps(-87.f));
+    __m128i n = _mm_cvtps_epi32(_mm_mul_ps(x, _mm_set1_ps(gabor_log2e)));
+    __m128 nf = _mm_cvtepi32_ps(n);
+    __m128 r = _mm_sub_ps(_mm_sub_ps(x, _mm_mul_ps(nf, _mm_set1_ps(gabor_ln2_hi))), _mm_mul_ps(nf, _mm_set1_ps(gabor_ln2_lo)));
+
+    __m128 p = _mm_set1_ps(gabor_exp_coefficients[degree]);
+    for (int k=degree-1 ; k>=0 ; k--) {
+        p = _mm_add_ps(_mm_mul_ps(p, r), _mm_set1_ps(gabor_exp_coefficients[k]));
+    }
+
+    __m128 scale = _mm_castsi128_ps(_mm_slli_epi32(_mm_add_epi32(n, _mm_set1_epi32(127)), 23));
+    return _mm_mul_ps(p, scale);
+
+}
+
+
+inline __m128 gabor_cos_sse (__m128 x, int degree) {
+
+    __m128i q = _mm_cvtps_epi32(_mm_mul_ps(x, _mm_set1_ps(gabor_inv_pi)));
+    __m128 qf = _mm_cvtepi32_ps(q);
+    __m128 r = _mm_sub_ps(x, _mm_mul_ps(qf, _mm_set1_ps(gabor_pi_1)));
+    r = _mm_sub_ps(r, _mm_mul_ps(qf, _mm_set1_ps(gabor_pi_2)));
+    r = _mm_sub_ps(r, _mm_mul_ps(qf, _mm_set1_ps(gabor_pi_3)));
+    __m128 z = _mm_mul_ps(r, r);
+
+    __m128 p = _mm_set1_ps(gabor_cos_coefficients[degree]);
+    for (int k=degree-1 ; k>=0 ; k--) {
+        p = _mm_add_ps(_mm_mul_ps(p, z), _mm_set1_ps(gabor_cos_coefficients[k]));
+    }
+
+    //odd multiples of pi flip the sign
+    __m128 sign = _mm_castsi128_ps(_mm_slli_epi32(q, 31));
+    return _mm_xor_ps(p, sign);
+
+}
+
+
+inline float gabor_kernel_sum_sse (Kernel_accuracy accuracy, float exp_factor, float kernel_radius, float x, float y, Impulse_list const& impulses) {
+
+    int exp_degree = gabor_exp_degree(accuracy);
+    int cos_degree = gabor_cos_degree(accuracy);
+
+    __m128 vx = _mm_set1_ps(x);
+    __m128 vy = _mm_set1_ps(y);
+    __m128 vradius = _mm_set1_ps(kernel_radius);
+    __m128 vexp_factor = _mm_set1_ps(exp_factor);
+    __m128 one = _mm_set1_ps(1.f);
+    __m128 sum = _mm_setzero_ps();
+
+    size_t n = impulses.size();
+    size_t i = 0;
+    for ( ; i+4<=n ; i+=4) {
+
+        __m128 ux = _mm_sub_ps(vx, _mm_loadu_ps(&impulses.x[i]));
+        __m128 uy = _mm_sub_ps(vy, _mm_loadu_ps(&impulses.y[i]));
+        __m128 inside = _mm_cmplt_ps(_mm_add_ps(_mm_mul_ps(ux, ux), _mm_mul_ps(uy, uy)), one);
+
+        __m128 dx = _mm_mul_ps(ux, vradius);
+        __m128 dy = _mm_mul_ps(uy, vradius);
+        __m128 d2 = _mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy));
+        __m128 phase = _mm_add_ps(_mm_mul_ps(_mm_loadu_ps(&impulses.harmonic_x[i]), dx), _mm_mul_ps(_mm_loadu_ps(&impulses.harmonic_y[i]), dy));
+
+        __m128 kernel = _mm_mul_ps(gabor_exp_sse(_mm_mul_ps(vexp_factor, d2), exp_degree), gabor_cos_sse(phase, cos_degree));
+        kernel = _mm_mul_ps(kernel, _mm_loadu_ps(&impulses.weight[i]));
+        sum = _mm_add_ps(sum, _mm_and_ps(kernel, inside));
+
+    }
+
+    float lanes[4];
+    _mm_storeu_ps(lanes, sum);
+    return ((lanes[0] + lanes[1]) + (lanes[2] + lanes[3])) + gabor_kernel_sum_scalar(accuracy, exp_factor, kernel_radius, x, y, impulses, i, n);
+
+}
+
+
+GABOR_KERNEL_AVX2 inline __m256 gabor_exp_avx2 (__m256 x, int degree) {
+
+    x = _mm256_max_ps(x, _mm256_set1_ps(-87.f));
+    __m256i n = _mm256_cvtps_epi32(_mm256_mul_ps(x, _mm256_set1_ps(gabor_log2e)));
+    __m256 nf = _mm256_cvtepi32_ps(n);
+    __m256 r = _mm256_fnmadd_ps(nf, _mm256_set1_ps(gabor_ln2_hi), x);
+    r = _mm256_fnmadd_ps(nf, _mm256_set1_ps(gabor_ln2_lo), r);
+
+    __m256 p = _mm256_set1_ps(gabor_exp_coefficients[degree]);
+    for (int k=degree-1 ; k>=0 ; k--) {
+        p = _mm256_fmadd_ps(p, r, _mm256_set1_ps(gabor_exp_coefficients[k]));
+    }
+
+    __m256 scale = _mm256_castsi256_ps(_mm256_slli_epi32(_mm256_add_epi32(n, _mm256_set1_epi32(127)), 23));
+    return _mm256_mul_ps(p, scale);
+
+}
+
+
+GABOR_KERNEL_AVX2 inline __m256 gabor_cos_avx2 (__m256 x, int degree) {
+
+    __m256i q = _mm256_cvtps_epi32(_mm256_mul_ps(x, _mm256_set1_ps(gabor_inv_pi)));
+    __m256 qf = _mm256_cvtepi32_ps(q);
+    __m256 r = _mm256_fnmadd_ps(qf, _mm256_set1_ps(gabor_pi_1), x);
+    r = _mm256_fnmadd_ps(qf, _mm256_set1_ps(gabor_pi_2), r);
+    r = _mm256_fnmadd_ps(qf, _mm256_set1_ps(gabor_pi_3), r);
+    __m256 z = _mm256_mul_ps(r, r);
+
+    __m256 p = _mm256_set1_ps(gabor_cos_coefficients[degree]);
+    for (int k=degree-1 ; k>=0 ; k--) {
+        p = _mm256_fmadd_ps(p, z, _mm256_set1_ps(gabor_cos_coefficients[k]));
+    }
+
+    //odd multiples of pi flip the sign
+    __m256 sign = _mm256_castsi256_ps(_mm256_slli_epi32(q, 31));
+    return _mm256_xor_ps(p, sign);
+
+}
+
+
+GABOR_KERNEL_AVX2 inline float gabor_kernel_sum_avx2 (Kernel_accuracy accuracy, float exp_factor, float kernel_radius, float x, float y, Impulse_list const& impulses) {
+
+    int exp_degree = gabor_exp_degree(accuracy);
+    int cos_degree = gabor_cos_degree(accuracy);
+
+    __m256 vx = _mm256_set1_ps(x);
+    __m256 vy = _mm256_set1_ps(y);
+    __m256 vradius = _mm256_set1_ps(kernel_radius);
+    __m256 vexp_factor = _mm256_set1_ps(exp_factor);
+    __m256 one = _mm256_set1_ps(1.f);
+    __m256 sum = _mm256_setzero_ps();
+
+    size_t n = impulses.size();
+    size_t i = 0;
+    for ( ; i+8<=n ; i+=8) {
+
+        __m256 ux = _mm256_sub_ps(vx, _mm256_loadu_ps(&impulses.x[i]));
+        __m256 uy = _mm256_sub_ps(vy, _mm256_loadu_ps(&impulses.y[i]));
+        __m256 inside = _mm256_cmp_ps(_mm256_fmadd_ps(ux, ux, _mm256_mul_ps(uy, uy)), one, _CMP_LT_OQ);
+
+        __m256 dx = _mm256_mul_ps(ux, vradius);
+        __m256 dy = _mm256_mul_ps(uy, vradius);
+        __m256 d2 = _mm256_fmadd_ps(dx, dx, _mm256_mul_ps(dy, dy));
+        __m256 phase = _mm256_fmadd_ps(_mm256_loadu_ps(&impulses.harmonic_x[i]), dx, _mm256_mul_ps(_mm256_loadu_ps(&impulses.harmonic_y[i]), dy));
+
+        __m256 kernel = _mm256_mul_ps(gabor_exp_avx2(_mm256_mul_ps(vexp_factor, d2), exp_degree), gabor_cos_avx2(phase, cos_degree));
+        sum = _mm256_add_ps(sum, _mm256_and_ps(_mm256_mul_ps(kernel, _mm256_loadu_ps(&impulses.weight[i])), inside));
+
+    }
+
+    float lanes[8];
+    _mm256_storeu_ps(lanes, sum);
+    float simd_sum = ((lanes[0] + lanes[1]) + (lanes[2] + lanes[3])) + ((lanes[4] + lanes[5]) + (lanes[6] + lanes[7]));
+    return simd_sum + gabor_kernel_sum_scalar(accuracy, exp_factor, kernel_radius, x, y, impulses, i, n);
+
+}
+
+
+inline bool cpu_supports_avx2 () {
+#ifdef _MSC_VER
+    int info[4];
+    __cpuidex(info, 0, 0);
+    if (info[0] < 7) {return false;}
+    __cpuidex(info, 1, 0);
+    bool fma = (info[2] & (1 << 12)) != 0;
+    bool osxsave = (info[2] & (1 << 27)) != 0;
+    if (!fma || !osxsave || (_xgetbv(0) & 6) != 6) {return false;}
+    __cpuidex(info, 7, 0);
+    return (info[1] & (1 << 5)) != 0;
+#else
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+#endif
+}
+
+#endif
+
+
+
+//instruction set used by gabor_kernel_sum, detected once
+inline Kernel_isa kernel_isa () {
+#ifdef GABOR_KERNEL_X86
+    static Kernel_isa const isa = cpu_supports_avx2() ? Kernel_isa::avx2 : Kernel_isa::sse;
+    return isa;
+#else
+    return Kernel_isa::scalar;
+#endif
+}
+
+
+//impulses within the kernel radius of the point, counted apart since the vectorized sums evaluate every lane
+inline size_t impulses_within_radius (float x, float y, Impulse_list const& impulses) {
+    size_t count = 0;
+    for (size_t i=0 ; i<impulses.size() ; i++) {
+        float ux = x - impulses.x[i];
+        float uy = y - impulses.y[i];
+        count += ux*ux + uy*uy < 1.f;
+    }
+    return count;
+}
+
+
+//K*sum of the kernels of a cell at the point (x,y) given in cell coordinates, for accuracy accurate or fast
+inline float gabor_kernel_sum (Kernel_accuracy accuracy, float K, float a, float kernel_radius, float x, float y, Impulse_list const& impulses) {
+
+    float exp_factor = -pi*a*a;
+    NOISE_COUNTERS_ONLY(Noise_counters::count_cell(impulses.size(), impulses_within_radius(x, y, impulses));)
+
+    switch (kernel_isa()) {
+#ifdef GABOR_KERNEL_X86
+        case Kernel_isa::avx2: return K*gabor_kernel_sum_avx2(accuracy, exp_factor, kernel_radius, x, y, impulses);
+        case Kernel_isa::sse: return K*gabor_kernel_sum_sse(accuracy, exp_factor, kernel_radius, x, y, impulses);
+#endif
+        default: return K*gabor_kernel_sum_scalar(accuracy, exp_factor, kernel_radius, x, y, impulses, 0, impulses.size());
+    }
+
+}
@@ -0,0 +1,144 @@
+#pragma once
+
+#include <list>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+#include "Impulse_list.h"
+
+using namespace std;
+
+//LRU cache of the impulses of the cells, keyed by the cell seed
+//the cache is split into independent shards, each protected by its own mutex, so that several threads can share it
+//the memory budget is shared equally by the shards, the least recently used cells of a shard are evicted first
+
+class Impulse_cache {
+
+    public:
+
+        struct Statistics {
+            size_t hits = 0;
+            size_t misses = 0;
+            size_t evictions = 0;
+            size_t entries = 0;
+            size_t memory = 0; // bytes currently used by the cached impulses
+        };
+
+
+        Impulse_cache (size_t memory_budget, unsigned number_of_shards=16)
+        :  m_shards(number_of_shards == 0 ? 1 : number_of_shards)
+        {
+            m_shard_memory_budget = memory_budget/m_shards.size();
+        }
+
+
+        shared_ptr<Impulse_list const> find (unsigned seed) {
+
+            Shard& shard = shard_of(seed);
+            lock_guard<mutex> lock(shard.access);
+
+            auto it = shard.entries.find(seed);
+            if (it == shard.entries.end()) {
+                shard.misses++;
+                return nullptr;
+            }
+
+            shard.hits++;
+            shard.lru.splice(shard.lru.begin(), shard.lru, it->second); // most recently used first
+            return it->second->second;
+
+        }
+
+
+        void insert (unsigned seed, shared_ptr<Impulse_list const> impulses) {
+
+            Shard& shard = shard_of(seed);
+            lock_guard<mutex> lock(shard.access);
+
+            if (shard.entries.find(seed) != shard.entries.end()) {return;} // another thread generated it meanwhile
+
+            shard.lru.emplace_front(seed, impulses);
+            shard.entries[seed] = shard.lru.begin();
+            shard.memory += impulses->memory_size();
+
+            while (shard.memory > m_shard_memory_budget && shard.lru.size() > 1) {
+                auto const& oldest = shard.lru.back();
+                shard.memory -= oldest.second->memory_size();
+                shard.entries.erase(oldest.first);
+                shard.lru.pop_back();
+                shard.evictions++;
+            }
+
+        }
+
+
+        //returns the cached impulses of the seed, or generates them with generate(seed, Impulse_list&) outside of the lock
+        template <typename Generator>
+        shared_ptr<Impulse_list const> get_or_generate (unsigned seed, Generator const& generate) {
+
+            shared_ptr<Impulse_list const> impulses = find(seed);
+
+            if (!impulses) {
+                shared_ptr<Impulse_list> generated = make_shared<Impulse_list>();
+                generate(seed, *generated);
+                impulses = generated;
+                insert(seed, impulses);
+            }
+
+            return impulses;
+
+        }
+
+
+        //counters of all shards merged
+        Statistics statistics () {
+
+            Statistics statistics;
+
+            for (Shard& shard : m_shards) {
+                lock_guard<mutex> lock(shard.access);
+                statistics.hits += shard.hits;
+                statistics.misses += shard.misses;
+                statistics.evictions += shard.evictions;
+                statistics.entries += shard.entries.size();
+                statistics.memory += shard.memory;
+            }
+
+            return statistics;
+
+        }
+
+
+        void clear () {
+            for (Shard& shard : m_shards) {
+                lock_guard<mutex> lock(shard.access);
+                shard.lru.clear();
+                shard.entries.clear();
+                shard.memory = 0;
+            }
+        }
+
+
+    private:
+
+        struct Shard {
+            mutex access;
+            list<pair<unsigned, shared_ptr<Impulse_list const>>> lru;
+            unordered_map<unsigned, list<pair<unsigned, shared_ptr<Impulse_list const>>>::iterator> entries;
+            size_t memory = 0;
+            size_t hits = 0;
+            size_t misses = 0;
+            size_t evictions = 0;
+        };
+
+        Shard& shard_of (unsigned seed) {
+            //neighbouring cells have close seeds, mix the bits before choosing the shard
+            unsigned h = seed*2654435761u;
+            return m_shards[(h >> 16) % m_shards.size()];
+        }
+
+        vector<Shard> m_shards;
+        size_t m_shard_memory_budget;
+
+};
@@ -0,0 +1,78 @@
+#pragma once
+
+#include <vector>
+#include <cmath>
+#include "vcl/vcl.hpp"
+
+using namespace std;
+using namespace vcl;
+
+//impulses of one cell, stored as a structure of arrays (one entry per impulse, in the order of the prng stream)
+
+struct Impulse_list {
+
+    vector<float> x;
+    vector<float> y;
+    vector<float> weight;
+    vector<float> F0;
+    vector<float> w0;
+    vector<float> harmonic_x; // 2*pi*F0*cos(w0), only filled by compute_harmonics
+    vector<float> harmonic_y; // 2*pi*F0*sin(w0)
+
+    size_t size () const {
+        return x.size();
+    }
+
+    //bytes used by the list, as counted by the memory budget of Impulse_cache
+    size_t memory_size () const {
+        return sizeof(Impulse_list) + sizeof(float)*(x.capacity() + y.capacity() + weight.capacity() + F0.capacity() + w0.capacity() + harmonic_x.capacity() + harmonic_y.capacity());
+    }
+
+    void clear () {
+        x.clear();
+        y.clear();
+        weight.clear();
+        F0.clear();
+        w0.clear();
+        harmonic_x.clear();
+        harmonic_y.clear();
+    }
+
+    void reserve (size_t n) {
+        x.reserve(n);
+        y.reserve(n);
+        weight.reserve(n);
+        F0.reserve(n);
+        w0.reserve(n);
+        harmonic_x.reserve(n);
+        harmonic_y.reserve(n);
+    }
+
+    //sizes the drawn parameters for a batch fill, the harmonics are left to compute_harmonics
+    void resize (size_t n) {
+        x.resize(n);
+        y.resize(n);
+        weight.resize(n);
+        F0.resize(n);
+        w0.resize(n);
+    }
+
+    void push_back (float xi, float yi, float wi, float F0i, float w0i) {
+        x.push_back(xi);
+        y.push_back(yi);
+        weight.push_back(wi);
+        F0.push_back(F0i);
+        w0.push_back(w0i);
+    }
+
+    //frequency vector of each impulse, needed by the vectorized kernels of Gabor_kernel.h
+    void compute_harmonics () {
+        harmonic_x.resize(size());
+        harmonic_y.resize(size());
+        for (size_t i=0 ; i<size() ; i++) {
+            harmonic_x[i] = 2.f*pi*F0[i]*cos(w0[i]);
+            harmonic_y[i] = 2.f*pi*F0[i]*sin(w0[i]);
+        }
+    }
+
+};
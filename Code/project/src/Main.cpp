@@ -3,25 +3,45 @@
 #include <cmath>
 #include <ctime>
 #include <vector>
+#include <list>
+#include <atomic>
+#include <mutex>
 #include "vcl/vcl.hpp"
 
 #include "Vec3.h"
+#include "Vertex_loops.h"
 //#include "Pseudo_random_number_generator.h"
 #include "Noise.h"
+#include "Noise_variants.h"
 #include "Surface_noise.h"
 #include "Window_helper.h"
+#include "Tile_renderer.h"
+#include "Update_graph.h"
+#include "Background_worker.h"
+#include "Progressive_grid.h"
+#include "Cancellation_token.h"
+#include "Noise_texture_cache.h"
+#include "Band_renderer.h"
 
 using namespace std;
 using namespace vcl;
 
-vector<Vec3f> black_and_white_noise_image (Noise noise, unsigned resolution);
-vector<Vec3f> black_and_white_spectrum_image (Noise noise, unsigned resolution);
-void save_as_ppm (vector<Vec3f> image, unsigned resolution, string file_name);
+raster<float> noise_image (Noise const& noise, unsigned resolution);
+raster<float> spectrum_image (Noise const& noise, unsigned resolution);
+template <typename Color>
+raster<uint8_t> black_and_white (raster<float> const& values, Color const& color);
+bool save_noise_streamed (Noise const& noise, unsigned resolution, string file_name, Band_format format);
 int interactive_2D_noise();
 int surface_noise_3D(bool map, float m_K, float m_a, float m_F0);
 void update_surface_noise(bool map, float m_K, float m_a, float m_F0);
-void update_2D_noise();
-Vec3f find_color(float t); //gives the linear interpolation of the color scale for t in [0,1]
+struct Noise_2D_request;
+Noise_2D_request noise_2D_request();
+void update_2D_noise(Noise_2D_request const& request, Cancellation_token const& cancellation);
+void upload_2D_noise();
+Update_graph noise_2D_update_graph();
+vector<float> const& intensity_field(int N, bool live_preview, bool& complete, Cancellation_token const& cancellation);
+template <typename Evaluate_row, typename Color>
+raster<float> save_as_pgm_progressively(unsigned resolution, string file_name, Evaluate_row const& evaluate_row, Color const& color);
 
 
 //same values as the ones in the window helper, don't forget to keep it the same
@@ -36,25 +56,137 @@ float w0_max = 2*pi;
 float number_of_impulses_per_kernel = 64.f;
 unsigned random_offset = time(0);
 bool is_periodic = false;
-
-Noise noise(K, a, F0_min, F0_max, w0_min, w0_max, number_of_impulses_per_kernel, random_offset, is_periodic);
+unsigned number_of_threads = 0; //threads rendering the images, 0 for all the hardware threads
+unsigned tile_size = 64;
+size_t vertex_grain_size = 4096; //fewest vertices coloured per task of the render pool, below that the loops stay on one thread
+size_t impulse_cache_memory = 64*1024*1024; //bytes of impulses kept by the cache of the uv mapped surface noise
+unsigned noise_texture_resolution = 2048; //texels per side of the noise texture baked in uv space for the uv mapped surface noise
+string noise_texture_folder = "../output/"; //the baked textures are saved there and reloaded when the parameters (random_offset included) are the same
+unsigned noise_texture_files = 4; //baked textures kept in noise_texture_folder (16 MB each at 2048 texels), the least recently used ones are deleted
+GLuint noise_texture = 0; //baked texture of the uv mapped surface noise
+bool progressive_rendering = true; //coarse to fine evaluation (every 8th, 4th, 2nd sample then all) of the 2D surface and of the saved images
+float refinement_budget_ms = 10.f; //time spent refining the 2D surface per frame
+bool spectral_synthesis = false; //saves a periodic fft synthesis of the noise image instead: same power spectrum, much faster for large images
+unsigned streamed_resolution = 0; //side of a noise image rendered band by band straight to the disk, its size is not limited by the memory, 0 to skip
+Band_format streamed_format = Band_format::pgm; //ppm, pgm or raw_float (the intensities)
+bool save_noise_intensities = false; //also saves the intensities of the noise image, not quantized, to ../output/noise.pfm
+
+Kernel_accuracy kernel_accuracy = Kernel_accuracy::exact; //exact, accurate or fast (preview)
+Poisson_sampler poisson_sampler = Poisson_sampler::knuth; //table is faster but gives other impulses than knuth
+Random_generator random_generator = Random_generator::sequential; //counter_based draws the impulses in batches but gives other impulses than sequential
+
+shared_ptr<Noise> noise = make_noise(K, a, F0_min, F0_max, w0_min, w0_max, number_of_impulses_per_kernel, random_offset, is_periodic, kernel_accuracy, random_generator);
+thread_pool render_pool(number_of_threads);
+
+//incremental update of the 2D noise surface: only the stages invalidated by the widgets that changed are rerun
+Update_graph update_graph = noise_2D_update_graph();
+struct Intensity_field {
+    float K, a, F0_min, F0_max, w0_min, w0_max;
+    bool is_periodic;
+    vector<float> intensity; //tile of the grid vertices, evaluated with this K
+};
+list<Intensity_field> intensity_fields; //raw intensities of the last parameter sets, most recent first
+unsigned intensity_field_cache_size = 8;
+float intensity_scale = 1.f; //6 standard deviations of the current noise
+bool noise_applied = false;
+unique_ptr<Progressive_grid> refinement; //field of the current parameters while it is progressively refined
+bool applied_height_noise = false;
+float applied_height_amplitude = 0.f;
+bool applied_color_scale = false;
 
 //vector<Vec3f> color_scale = {Vec3f(0.9,0.8,0.67),Vec3f(0.6,0.53,0.38)};
 vector<Vec3f> color_scale = {Vec3f(1,0,0),Vec3f(0,0,1)};
 
+//the 2D noise surface is recomputed on a background worker into worker_shape while the render loop keeps drawing visual,
+//the vertex buffers that changed are then copied into shape and uploaded by the render thread
+struct Noise_2D_request { //widget values when "Apply changes" was clicked
+    float K, a, F0_min, F0_max, w0_min, w0_max;
+    bool is_periodic;
+    bool height_noise;
+    float height_amplitude;
+    bool color_scale;
+    bool live_preview;
+    bool operator== (Noise_2D_request const& other) const {
+        return K == other.K && a == other.a && F0_min == other.F0_min && F0_max == other.F0_max && w0_min == other.w0_min && w0_max == other.w0_max
+            && is_periodic == other.is_periodic && height_noise == other.height_noise && height_amplitude == other.height_amplitude && color_scale == other.color_scale
+            && live_preview == other.live_preview;
+    }
+};
+mesh worker_shape; //only used by the worker
+mutex shape_access; //guards shape and the flags of the buffers to upload
+bool position_to_upload = false;
+bool normal_to_upload = false;
+bool color_to_upload = false;
+atomic<float> update_progress(1.f);
+atomic<bool> refinement_pending(false); //the render loop submits the next refinement step once the worker is idle
+Noise_2D_request last_request; //only used by the render thread
+shared_ptr<Cancellation_token> update_cancellation = make_shared<Cancellation_token>(); //cancelled when a newer request is submitted
+Background_worker update_worker; //declared last, so that it is stopped before the data it uses is destroyed
+
 //for anisotropic noise, F0min=F0max and w0min=w0max (pi/4 for instance)
 //for isotropic noise, F0min=F0max and [w0min,w0max]=[0,2pi]
 int main(int argc, char** argv){
 
+    noise->set_poisson_sampler(poisson_sampler);
+
     //save images of the noise and its power spectrum
 
-    vector<Vec3f> noise_image = black_and_white_noise_image(noise,256);
-    save_as_ppm(noise_image, 256, "noise");
-    cout<<"noise saved"<<endl;
+    if (progressive_rendering && !spectral_synthesis) {
+
+        //a preview of each image is saved after each level of refinement
+        unsigned resolution = 256;
+        float origin = 0.5f - float(resolution)/2.f;
+        float scale = 6.f*sqrt(noise->variance());
+
+        raster<float> intensities = save_as_pgm_progressively(resolution, "noise", [&](unsigned x_begin, unsigned y, unsigned count, unsigned x_step, float* out) {
+            noise->evaluate_tile(origin + float(x_begin), origin + float(y), count, 1, float(x_step), out);
+        }, [&](float noise_intensity) {
+            return 0.5f + noise_intensity/scale; //the value is centered between 0 and 1
+        });
+        if (save_noise_intensities) {image_save_pfm("../output/noise.pfm", intensities);}
+        cout<<"noise saved"<<endl;
+
+        //the levels visit both pixels of each pair of opposite frequencies, the memo evaluates one of them
+        noise->enable_spectrum_memo(resolution, 1.1f);
+        save_as_pgm_progressively(resolution, "spectrum", [&](unsigned x_begin, unsigned y, unsigned count, unsigned x_step, float* out) {
+            for (unsigned k=0 ; k<count ; k++) {
+                out[k] = noise->spectrum_pixel(x_begin + k*x_step, y, resolution, 1.1f);
+            }
+        }, [&](float normed_spectrum_intensity) {
+            return normed_spectrum_intensity;
+        });
+        noise->disable_spectrum_memo();
+        cout<<"spectrum saved"<<endl;
 
-    vector<Vec3f> spectrum_image = black_and_white_spectrum_image(noise,256);
-    save_as_ppm(spectrum_image, 256, "spectrum");
-    cout<<"spectrum saved"<<endl;
+    }
+
+    else {
+
+        float scale = 6.f*sqrt(noise->variance());
+
+        raster<float> intensities = noise_image(*noise,256);
+        image_save_pgm("../output/noise.pgm", black_and_white(intensities, [&](float noise_intensity) {
+            float normed_noise_intensity = 0.5 + noise_intensity/scale; //the value is centered between 0 and 1
+            return normed_noise_intensity;
+        }));
+        if (save_noise_intensities) {image_save_pfm("../output/noise.pfm", intensities);}
+        cout<<"noise saved"<<endl;
+
+        image_save_pgm("../output/spectrum.pgm", black_and_white(spectrum_image(*noise,256), [&](float normed_spectrum_intensity) {
+            return normed_spectrum_intensity;
+        }));
+        cout<<"spectrum saved"<<endl;
+
+    }
+
+
+    //an interrupted render is resumed from its last band when it is run again with the same parameters
+    if (streamed_resolution > 0) {
+        string extension = streamed_format == Band_format::ppm ? ".ppm" : streamed_format == Band_format::pgm ? ".pgm" : ".raw";
+        if (save_noise_streamed(*noise, streamed_resolution, "../output/noise_streamed" + extension, streamed_format)) {
+            cout<<"streamed noise saved"<<endl;
+        }
+    }
 
 
     //3D interactive visualisation
@@ -73,36 +205,40 @@ int main(int argc, char** argv){
 
 
 
-vector<Vec3f> black_and_white_noise_image (Noise noise, unsigned resolution) {
-
-    vector<Vec3f> image;
-    image.resize(resolution*resolution);
+//pixel (j,i) of the image holds the intensity of the sample (i, resolution-1-j)
+raster<float> noise_image (Noise const& noise, unsigned resolution) {
 
-    float scale = 6.f*sqrt(noise.variance());
+    raster<float> image(resolution, resolution);
 
-    for (unsigned i=0 ; i<resolution ; i++) {
-        for (unsigned j=0 ; j<resolution ; j++) {
+    if (spectral_synthesis) {
 
-            //change of coordinates to have the (x,y) axis system centered
-            float x = float(i) + 0.5f - float(resolution)/2.f;
-            float y = float(resolution - 1 - j) + 0.5f - float(resolution)/2.f;
-            float normed_noise_intensity = 0.5 + noise.intensity(x,y)/scale; //the value is centered between 0 and 1
+        grid_2D<float> synthesis = noise.spectral_synthesis(resolution, 1.f, random_offset, render_pool);
 
-            //save black and white pixel color
-            if (normed_noise_intensity <= 0.f) {
-                image[i*resolution + j] = Vec3f(0,0,0);
+        for (unsigned i=0 ; i<resolution ; i++) {
+            for (unsigned j=0 ; j<resolution ; j++) {
+                image(j, i) = synthesis(size_t(i), size_t(resolution - 1 - j));
             }
+        }
 
-            else if (normed_noise_intensity >= 1.f){
-                image[i*resolution + j] = Vec3f(255,255,255);
-            }
+        return image;
 
-            else {
-                image[i*resolution + j] = normed_noise_intensity*Vec3f(255,255,255);
-            }
+    }
+
+    //change of coordinates to have the (x,y) axis system centered, row py of a tile holds y = py + 0.5 - resolution/2
+    float origin = 0.5f - float(resolution)/2.f;
 
+    Tile_renderer(render_pool, tile_size).render(resolution, resolution, [&](unsigned x_begin, unsigned y_begin, unsigned width, unsigned height) {
+
+        vector<float> tile(width*height);
+        noise.evaluate_tile(origin + float(x_begin), origin + float(y_begin), width, height, 1.f, tile.data());
+
+        for (unsigned py=0 ; py<height ; py++) {
+            for (unsigned px=0 ; px<width ; px++) {
+                image(resolution - 1 - (y_begin + py), x_begin + px) = tile[py*width + px];
+            }
         }
-    }
+
+    });
 
     return image;
 
@@ -110,37 +246,36 @@ vector<Vec3f> black_and_white_noise_image (Noise noise, unsigned resolution) {
 
 
 
-vector<Vec3f> black_and_white_spectrum_image (Noise noise, unsigned resolution) {
+//pixel (j,i) of the image holds the spectrum at the frequency of the sample (i, resolution-1-j)
+raster<float> spectrum_image (Noise const& noise, unsigned resolution) {
 
-    vector<Vec3f> image;
-    image.resize(resolution*resolution);
+    raster<float> image(resolution, resolution);
 
-    float scale = 6.f*sqrt(noise.variance());
+    //the engine renders the frequencies (x + 0.5 - resolution/2)*1.1*2/resolution centered on the image, mirroring its symmetric part
+    vector<float> spectrum(resolution*resolution);
+    noise.spectrum_engine().render(resolution, 1.1f, spectrum.data(), render_pool);
 
     for (unsigned i=0 ; i<resolution ; i++) {
         for (unsigned j=0 ; j<resolution ; j++) {
+            image(j, i) = spectrum[(resolution - 1 - j)*resolution + i];
+        }
+    }
 
-            //change of coordinates to have the (x,y) axis system centered
-            float fx = float(i) + 0.5f - float(resolution)/2.f;
-            float fy = float(resolution - 1 - j) + 0.5f - float(resolution)/2.f;
-            fx *= 1.1f*2.f/float(resolution);
-            fy *= 1.1f*2.f/float(resolution);
-            float normed_spectrum_intensity = noise.power_spectrum(fx,fy);
+    return image;
 
-            //save black and white pixel color
-            if (normed_spectrum_intensity <= 0.f) {
-                image[i*resolution + j] = Vec3f(0,0,0);
-            }
+}
 
-            else if (normed_spectrum_intensity >= 1.f){
-                image[i*resolution + j] = Vec3f(255,255,255);
-            }
 
-            else {
-                image[i*resolution + j] = normed_spectrum_intensity*Vec3f(255,255,255);
-            }
 
-        }
+//8 bits grey levels of color(value), clamped to [0,1]
+template <typename Color>
+raster<uint8_t> black_and_white (raster<float> const& values, Color const& color) {
+
+    raster<uint8_t> image(values.width, values.height);
+
+    for (size_t k=0 ; k<values.data.size() ; k++) {
+        float t = color(values.data[k]);
+        image.data[k] = static_cast<uint8_t>(min(max(t, 0.f), 1.f)*255.f);
     }
 
     return image;
@@ -149,21 +284,65 @@ vector<Vec3f> black_and_white_spectrum_image (Noise noise, unsigned resolution)
 
 
 
-void save_as_ppm (vector<Vec3f> image, unsigned resolution, string file_name) {
+//same image as noise_image in black and white, rendered by bands written to the file as they are done: the memory is a few bands whatever the resolution
+//the pixel (c,r) of the file shows the sample (r, resolution-1-c), so a tile of the file is a transposed tile of the noise
+bool save_noise_streamed (Noise const& noise, unsigned resolution, string file_name, Band_format format) {
 
-    ofstream file;
-    file.open("../output/"+file_name+".ppm");
-    file<<"P6\n"<<resolution<<" "<<resolution<<"\n255\n";
+    float scale = 6.f*sqrt(noise.variance());
+    float origin = 0.5f - float(resolution)/2.f;
 
-    Vec3f color;
-    for (unsigned i=0 ; i<resolution ; i++) {
-        for (unsigned j=0 ; j<resolution ; j++) {
-            color = image[i*resolution + j];
-            file<<static_cast<unsigned char>(color[0])<<static_cast<unsigned char>(color[1])<<static_cast<unsigned char>(color[2]);   //write as ascii
+    //the checkpoint of another noise is not resumed, the noise is the one of the global parameters
+    stringstream key;
+    key<<K<<" "<<a<<" "<<F0_min<<" "<<F0_max<<" "<<w0_min<<" "<<w0_max<<" "<<number_of_impulses_per_kernel<<" "<<random_offset<<" "<<is_periodic
+       <<" "<<int(noise.kernel_accuracy())<<" "<<int(noise.poisson_sampler())<<" "<<int(random_generator);
+
+    Band_renderer renderer(render_pool, tile_size);
+    return renderer.render(file_name, resolution, resolution, format, key.str(), [&](unsigned x_begin, unsigned y_begin, unsigned width, unsigned height, float* out) {
+
+        vector<float> tile(width*height);
+        noise.evaluate_tile(origin + float(y_begin), origin + float(resolution - x_begin - width), height, width, 1.f, tile.data());
+
+        for (unsigned py=0 ; py<height ; py++) {
+            for (unsigned px=0 ; px<width ; px++) {
+                out[py*width + px] = tile[(width - 1 - px)*height + py];
+            }
         }
+
+    }, [&](float noise_intensity) {
+        return 0.5f + noise_intensity/scale; //the value is centered between 0 and 1
+    });
+
+}
+
+
+
+//value(x,y) is evaluated on a progressive grid, then color(value) in [0,1] is saved in black and white after each level of refinement
+//pixel (j,i) of the image shows the sample (i, resolution-1-j), as in noise_image, the values of the last level are returned in this layout
+template <typename Evaluate_row, typename Color>
+raster<float> save_as_pgm_progressively (unsigned resolution, string file_name, Evaluate_row const& evaluate_row, Color const& color) {
+
+    Progressive_grid grid(resolution, resolution);
+    raster<float> values(resolution, resolution);
+
+    while (!grid.complete()) {
+
+        unsigned step = grid.step();
+        grid.refine(evaluate_row, refinement_budget_ms, render_pool);
+        if (grid.step() == step) {continue;} //the level is not finished yet
+
+        for (unsigned i=0 ; i<resolution ; i++) {
+            for (unsigned j=0 ; j<resolution ; j++) {
+                values(j, i) = grid.values()[(resolution - 1 - j)*resolution + i];
+            }
+        }
+
+        image_save_pgm("../output/"+file_name+".pgm", black_and_white(values, color));
+        cout<<file_name<<" preview saved (every "<<step<<" pixels)"<<endl;
+
     }
 
-    file.close();
+    return values;
+
 }
 
 
@@ -179,6 +358,7 @@ int interactive_2D_noise(){
     glfwSetWindowSizeCallback(window, window_size_callback);
 
     initialize_2D_data();
+    worker_shape = shape;
 
     user.fps_record.start();
     glEnable(GL_DEPTH_TEST);
@@ -202,17 +382,29 @@ int interactive_2D_noise(){
 
             display_interface();
 
-            if (need_update){
+            //in live preview need_update is set at every frame, the update only restarts when a value changed
+            //a new request cancels the one being evaluated, so that only the most recent one is finished at full resolution
+            if (need_update && !(w_live_preview && noise_2D_request() == last_request)){
                 cout<<"3D surface update"<<endl;
-                update_2D_noise();}
+                last_request = noise_2D_request();
+                update_cancellation->cancel();
+                update_cancellation = make_shared<Cancellation_token>();
+                update_worker.submit([request = last_request, cancellation = update_cancellation]() { update_2D_noise(request, *cancellation); });}
+            else if (refinement_pending && !update_worker.busy()) {
+                update_worker.submit([request = last_request, cancellation = update_cancellation]() { update_2D_noise(request, *cancellation); });}
+            upload_2D_noise();
             draw(visual,scene);
 
             ImGui::End();
+            display_status(update_worker.busy(), update_progress);
             imgui_render_frame(window);
             glfwSwapBuffers(window);
             glfwPollEvents();
     }
 
+    //the update being evaluated stops at its next check, the worker is then joined when the globals are destroyed
+    update_cancellation->cancel();
+
     imgui_cleanup();
     glfwDestroyWindow(window);
     glfwTerminate();
@@ -258,6 +450,7 @@ int surface_noise_3D(bool map, float m_K, float m_a, float m_F0){
             draw(visual,scene);
 
             ImGui::End();
+            display_status(false, 0.f);
             imgui_render_frame(window);
             glfwSwapBuffers(window);
             glfwPollEvents();
@@ -282,34 +475,39 @@ void update_surface_noise(bool map, float m_K, float m_a, float m_F0){
     if (map) {
 
         Noise surface_noise = Noise(m_K, m_a, m_F0, m_F0, 0.f, 2.f*pi, number_of_impulses_per_kernel, random_offset, is_periodic);
+        surface_noise.enable_impulse_cache(impulse_cache_memory);  //neighbouring bands of texels share most of their cells
         float scale = 6.f*sqrt(surface_noise.variance());
 
-        for (size_t i=0 ; i<shape.position.size() ; i++){
+        //the noise is baked at noise_texture_resolution texels per side whatever the number of vertices, or reloaded from the disk
+        Noise_texture_parameters parameters = {m_K, m_a, m_F0, m_F0, 0.f, 2.f*pi, number_of_impulses_per_kernel, random_offset, is_periodic, noise_texture_resolution, 500.f};
+        Noise_texture_cache cache(noise_texture_folder, noise_texture_files);
+        grid_2D<float> atlas;
 
-            vec2 p_2D = shape.uv[i];
-            float noise_intensity = surface_noise.intensity(500*p_2D[0],500*p_2D[1]);
+        if (cache.load(parameters, atlas)) {
+            cout<<"noise texture loaded from "<<cache.file_name(parameters)<<endl;
+        }
+        else {
+            atlas = surface_noise.bake_uv_texture(noise_texture_resolution, 500.f, render_pool);
+            cache.save(parameters, atlas);
+            Impulse_cache::Statistics statistics = surface_noise.impulse_cache_statistics();
+            cout<<"noise texture baked, impulse cache : "<<statistics.hits<<" hits, "<<statistics.misses<<" misses, "<<statistics.evictions<<" evictions, "<<statistics.entries<<" cells in "<<statistics.memory/1024<<" kB"<<endl;
+        }
 
-            if (0.5f + noise_intensity/(scale) <= 0.f) {
-                float t = 0.f;
-                shape.color[i][0] = find_color(t)[0];
-                shape.color[i][1] = find_color(t)[1];
-                shape.color[i][2] = find_color(t)[2];
-            }
-            else if (0.5f + noise_intensity/(scale) >= 1.f) {
-                float t = 1.f;
-                shape.color[i][0] = find_color(t)[0];
-                shape.color[i][1] = find_color(t)[1];
-                shape.color[i][2] = find_color(t)[2];
-            }
-            else {
-                float t = 0.5f + noise_intensity/(scale);
-                shape.color[i][0] = find_color(t)[0];
-                shape.color[i][1] = find_color(t)[1];
-                shape.color[i][2] = find_color(t)[2];
-            }
+        grid_2D<vec3> texture_colors(noise_texture_resolution, noise_texture_resolution);
+        for (size_t k=0 ; k<atlas.size() ; k++) {
+            float t = min(max(0.5f + atlas[k]/(scale), 0.f), 1.f);
+            Vec3f color = find_color(color_scale, t);
+            texture_colors[k] = vec3(color[0], color[1], color[2]);
+        }
 
+        //the vertices are white, the colour comes from the texture
+        for (size_t i=0 ; i<shape.position.size() ; i++){
+            shape.color[i] = vec3(1.f, 1.f, 1.f);
         }
 
+        if (noise_texture != 0) {glDeleteTextures(1, &noise_texture);}
+        noise_texture = opengl_texture_to_gpu(texture_colors);
+
     }
 
     else {
@@ -321,135 +519,293 @@ void update_surface_noise(bool map, float m_K, float m_a, float m_F0){
         Surface_noise surface_noise = Surface_noise(m_K, m_a, m_F0, number_of_impulses_per_kernel, random_offset, is_periodic);
         float scale = 6.f*sqrt(surface_noise.variance());
 
-        for (size_t i=0 ; i<shape.position.size() ; i++){
-
-            vec3 p = shape.position[i];
-            vec3 n = shape.normal[i];
-            float noise_intensity = surface_noise.intensity(500*p[0],500*p[1],500*p[2],n);
-
-            if (0.5f + noise_intensity/(scale) <= 0.f) {
-                float t = 0.f;
-                shape.color[i][0] = find_color(t)[0];
-                shape.color[i][1] = find_color(t)[1];
-                shape.color[i][2] = find_color(t)[2];
-            }
-            else if (0.5f + noise_intensity/(scale) >= 1.f) {
-                float t = 1.f;
-                shape.color[i][0] = find_color(t)[0];
-                shape.color[i][1] = find_color(t)[1];
-                shape.color[i][2] = find_color(t)[2];
-            }
-            else {
-                float t = 0.5f + noise_intensity/(scale);
-                shape.color[i][0] = find_color(t)[0];
-                shape.color[i][1] = find_color(t)[1];
-                shape.color[i][2] = find_color(t)[2];
-            }
-
-        }
+        buffer<float> intensities;
+        surface_noise.evaluate_mesh(shape, intensities, render_pool, 500.f);
 
+        color_vertices(render_pool, shape.position.size(), vertex_grain_size, [&](size_t i) { return intensities[i]; }, scale, color_scale, shape.color);
 
     }
 
     visual.clear();
     visual = mesh_drawable(shape);
     visual.shading.phong = {0.3f, 0.6f, 0.05f, 64};
+    if (map) {
+        visual.texture = noise_texture;
+        visual.shading.texture_inverse_y = true; //the rows of the baked texture go up with v
+    }
 
 }
 
 
 
-void update_2D_noise(){
+//intensity -> height -> normals -> upload
+//intensity -> colour -> upload
+Update_graph noise_2D_update_graph(){
+
+    Update_graph graph;
+    graph.add_dependency(Update_stage::intensity, Update_stage::height);
+    graph.add_dependency(Update_stage::intensity, Update_stage::colour);
+    graph.add_dependency(Update_stage::height, Update_stage::normals);
+    graph.add_dependency(Update_stage::normals, Update_stage::upload);
+    graph.add_dependency(Update_stage::colour, Update_stage::upload);
+    return graph;
 
-    K = w_K;
-    a = w_a;
-    F0_min = w_F0_min;
-    F0_max = w_F0_max;
-    w0_min = w_w0_min;
-    w0_max = w_w0_max;
-    is_periodic = w_is_periodic;
+}
 
-    noise = Noise(K, a, F0_min, F0_max, w0_min, w0_max, number_of_impulses_per_kernel, random_offset, is_periodic);
 
-    /**if (w_anisotropic_filtering){
-        vector<float> new_params = noise.anisotropically_filter(F0_min,w0_min);
-        K = new_params[0];
-        a = new_params[1];
-        F0_min = new_params[2];
-        F0_max = new_params[2];
-        w0_min = new_params[3];
-        w0_max = new_params[3];
-        noise = Noise(K, a, F0_min, F0_max, w0_min, w0_max, number_of_impulses_per_kernel, random_offset, is_periodic);
-    }*/
 
-    int N = int(sqrt(shape.position.size()));
-    float scale = 6.f*sqrt(noise.variance());
+//intensities of the grid vertices for the current parameters, reused from the cache when the parameters were already applied
+//K only scales the noise, so a field computed with another K is rescaled instead of evaluated again
+//in progressive mode, each call refines the field during refinement_budget_ms, complete tells whether it is finished
+//a cancelled evaluation returns an incomplete field that is not kept
+vector<float> const& intensity_field(int N, bool live_preview, bool& complete, Cancellation_token const& cancellation){
 
-    for (int j=0 ; j<N ; j++) {
-        for (int i=0 ; i<N ; i++) {
+    complete = true;
 
-            vec3 p = shape.position[j*N+i];
-            float noise_intensity = noise.intensity(100*p[0],100*p[1]);
+    for (auto it = intensity_fields.begin() ; it != intensity_fields.end() ; it++) {
 
-            if (w_height_noise) {
-                shape.position[j*N+i][2] = w_height_amplitude*noise_intensity/(scale);
-            }
+        if (it->a == a && it->F0_min == F0_min && it->F0_max == F0_max && it->w0_min == w0_min && it->w0_max == w0_max && it->is_periodic == is_periodic) {
 
-            else {
-                shape.position[j*N+i][2] = 0.f;
+            intensity_fields.splice(intensity_fields.begin(), intensity_fields, it);
+            Intensity_field& field = intensity_fields.front();
+
+            if (field.K != K) {
+                float rescale = K/field.K;
+                for (float& value : field.intensity) {value *= rescale;}
+                field.K = K;
             }
 
-            if (w_color_scale) {
-                if (0.5f + noise_intensity/(scale) <= 0.f) {
-                    float t = 0.f;
-                    shape.color[j*N+i][0] = find_color(t)[0];
-                    shape.color[j*N+i][1] = find_color(t)[1];
-                    shape.color[j*N+i][2] = find_color(t)[2];
-                }
-                else if (0.5f + noise_intensity/(scale) >= 1.f) {
-                    float t = 1.f;
-                    shape.color[j*N+i][0] = find_color(t)[0];
-                    shape.color[j*N+i][1] = find_color(t)[1];
-                    shape.color[j*N+i][2] = find_color(t)[2];
-                }
-                else {
-                    float t = 0.5f + noise_intensity/(scale);
-                    shape.color[j*N+i][0] = find_color(t)[0];
-                    shape.color[j*N+i][1] = find_color(t)[1];
-                    shape.color[j*N+i][2] = find_color(t)[2];
-                }
+            refinement.reset();
+            return field.intensity;
+
+        }
+
+    }
+
+    //the sample (x,y) of the field is the vertex x*N+y, evaluated at its own position scaled by 100 as intensity would be
+    auto evaluate_vertices = [&](unsigned x_begin, unsigned y_begin, unsigned width, unsigned height, unsigned x_step, float* out) {
+        vector<float> px(width*height), py(width*height);
+        for (unsigned y=0 ; y<height ; y++) {
+            for (unsigned x=0 ; x<width ; x++) {
+                vec3 const& p = worker_shape.position[(x_begin + x*x_step)*N + y_begin + y];
+                px[y*width + x] = 100*p[0];
+                py[y*width + x] = 100*p[1];
             }
+        }
+        noise->evaluate_points(px, py, out);
+    };
+
+    //the live preview restarts at low resolution after each change
+    if (progressive_rendering || live_preview) {
+
+        if (!refinement) {refinement.reset(new Progressive_grid(N, N));}
+
+        refinement->refine([&](unsigned x_begin, unsigned y, unsigned count, unsigned x_step, float* out) {
+            evaluate_vertices(x_begin, y, count, 1, x_step, out);
+        }, refinement_budget_ms, render_pool, &cancellation);
+        update_progress = refinement->progress();
+
+        complete = refinement->complete();
+        if (!complete) {return refinement->values();}
+
+        intensity_fields.push_front({K, a, F0_min, F0_max, w0_min, w0_max, is_periodic, refinement->values()});
+        refinement.reset();
+        if (intensity_fields.size() > intensity_field_cache_size) {
+            intensity_fields.pop_back();
+        }
+        return intensity_fields.front().intensity;
+
+    }
 
-            else {
-                shape.color[j*N+i][0] = 1.f;
-                shape.color[j*N+i][1] = 1.f;
-                shape.color[j*N+i][2] = 1.f;
+    static vector<float> field;
+    field.resize(N*N);
+
+    //evaluated by tiles to report the progress
+    Tile_renderer renderer(render_pool, tile_size);
+    unsigned number_of_tiles = ((N + tile_size - 1)/tile_size)*((N + tile_size - 1)/tile_size);
+    atomic<unsigned> tiles_done(0);
+
+    renderer.render(N, N, [&](unsigned x_begin, unsigned y_begin, unsigned width, unsigned height) {
+
+        vector<float> tile(width*height);
+        evaluate_vertices(x_begin, y_begin, width, height, 1, tile.data());
+
+        for (unsigned py=0 ; py<height ; py++) {
+            for (unsigned px=0 ; px<width ; px++) {
+                field[(y_begin + py)*N + x_begin + px] = tile[py*width + px];
             }
         }
+
+        update_progress = float(++tiles_done)/float(number_of_tiles);
+
+    }, &cancellation);
+
+    if (cancellation.cancelled()) {
+        complete = false;
+        return field;
     }
 
-    shape = shape.compute_normal();
-    visual.clear();
-    visual = mesh_drawable(shape);
-    visual.shading.phong = {0.3f, 0.6f, 0.05f, 64};
+    intensity_fields.push_front({K, a, F0_min, F0_max, w0_min, w0_max, is_periodic, field});
+    if (intensity_fields.size() > intensity_field_cache_size) {
+        intensity_fields.pop_back();
+    }
+
+    return intensity_fields.front().intensity;
+
+}
+
 
+
+Noise_2D_request noise_2D_request(){
+    return {w_K, w_a, w_F0_min, w_F0_max, w_w0_min, w_w0_max, w_is_periodic, w_height_noise, w_height_amplitude, w_color_scale, w_live_preview};
 }
 
 
 
-Vec3f find_color(float t){
+//runs on the background worker, gives up as soon as the request is cancelled by a newer one
+void update_2D_noise(Noise_2D_request const& request, Cancellation_token const& cancellation){
+
+    if (cancellation.cancelled()) {return;}
 
-    int n = color_scale.size();
-    int i = floor(t*float(n-1));
+    update_progress = 0.f;
 
-    if (i==n-1) {
-        return color_scale[n-1];
+    //stages invalidated by the widgets that changed since the last update
+    bool noise_changed = !noise_applied || request.K != K || request.a != a || request.F0_min != F0_min || request.F0_max != F0_max || request.w0_min != w0_min || request.w0_max != w0_max || request.is_periodic != is_periodic;
+    if (noise_changed) {
+        update_graph.invalidate(Update_stage::intensity);
+    }
+    if (request.height_noise != applied_height_noise || request.height_amplitude != applied_height_amplitude) {
+        update_graph.invalidate(Update_stage::height);
+    }
+    if (request.color_scale != applied_color_scale) {
+        update_graph.invalidate(Update_stage::colour);
     }
 
-    else {
-        float tbis = (t-float(i)/float(n-1))/(float(i+1)/float(n-1)-float(i)/float(n-1));
-        return (1.f-tbis)*color_scale[i] + tbis*color_scale[i+1];
+    K = request.K;
+    a = request.a;
+    F0_min = request.F0_min;
+    F0_max = request.F0_max;
+    w0_min = request.w0_min;
+    w0_max = request.w0_max;
+    is_periodic = request.is_periodic;
+    applied_height_noise = request.height_noise;
+    applied_height_amplitude = request.height_amplitude;
+    applied_color_scale = request.color_scale;
+
+    int N = int(sqrt(worker_shape.position.size()));
+    vector<float> const* field = intensity_fields.empty() ? nullptr : &intensity_fields.front().intensity;
+
+    if (noise_changed) {
+
+        //specialized noise for the isotropic, anisotropic or banded parameters chosen in the interface
+        noise = make_noise(K, a, F0_min, F0_max, w0_min, w0_max, number_of_impulses_per_kernel, random_offset, is_periodic, kernel_accuracy, random_generator);
+        noise->set_poisson_sampler(poisson_sampler);
+
+        /**if (w_anisotropic_filtering){
+            vector<float> new_params = noise.anisotropically_filter(F0_min,w0_min);
+            K = new_params[0];
+            a = new_params[1];
+            F0_min = new_params[2];
+            F0_max = new_params[2];
+            w0_min = new_params[3];
+            w0_max = new_params[3];
+            noise = Noise(K, a, F0_min, F0_max, w0_min, w0_max, number_of_impulses_per_kernel, random_offset, is_periodic);
+        }*/
+
+        intensity_scale = 6.f*sqrt(noise->variance());
+        noise_applied = true;
+        refinement.reset();
+
     }
+
+    if (update_graph.is_dirty(Update_stage::intensity)) {
+
+        bool complete;
+        field = &intensity_field(N, request.live_preview, complete, cancellation);
+
+        //the intensity stage stays invalidated, the newer request evaluates it again
+        if (cancellation.cancelled()) {
+            refinement.reset();
+            refinement_pending = false;
+            return;
+        }
+
+        refinement_pending = !complete;
+        if (complete) {update_graph.validate(Update_stage::intensity);}
+
+        //each refinement step changes the field while the intensity stage stays invalidated until it is complete,
+        //the stages built on the field are invalidated again so that they show the refined values
+        update_graph.invalidate_dependents(Update_stage::intensity);
+
+    }
+
+    bool height_updated = update_graph.is_dirty(Update_stage::height);
+    bool colour_updated = update_graph.is_dirty(Update_stage::colour);
+    bool normals_updated = update_graph.is_dirty(Update_stage::normals);
+
+    vector<float> const& tile = *field;
+    float scale = intensity_scale;
+
+    //the vertex j*N+i is at (i,j) and its intensity at tile[i*N+j], each range of vertices only writes its own position and colour
+    size_t number_of_vertices = size_t(N)*size_t(N);
+
+    auto vertex_intensity = [&](size_t k) { return tile[(k%N)*N + k/N]; };
+
+    if (update_graph.is_dirty(Update_stage::height)) {
+
+        displace_vertices(render_pool, number_of_vertices, vertex_grain_size, [&](size_t k) { return request.height_noise ? vertex_intensity(k) : 0.f; }, request.height_amplitude, scale, worker_shape.position);
+
+        update_graph.validate(Update_stage::height);
+
+    }
+
+    if (update_graph.is_dirty(Update_stage::colour)) {
+
+        color_vertices(render_pool, number_of_vertices, vertex_grain_size, vertex_intensity, scale, request.color_scale ? color_scale : vector<Vec3f>{Vec3f(1.f,1.f,1.f)}, worker_shape.color);
+
+        update_graph.validate(Update_stage::colour);
+
+    }
+
+    if (update_graph.is_dirty(Update_stage::normals)) {
+        worker_shape.compute_normal();
+        update_graph.validate(Update_stage::normals);
+    }
+
+    //hands the buffers that changed to the render thread, which sends them to the gpu with upload_2D_noise
+    if (update_graph.is_dirty(Update_stage::upload)) {
+
+        lock_guard<mutex> lock(shape_access);
+        if (height_updated) {shape.position = worker_shape.position; position_to_upload = true;}
+        if (normals_updated) {shape.normal = worker_shape.normal; normal_to_upload = true;}
+        if (colour_updated) {shape.color = worker_shape.color; color_to_upload = true;}
+        update_graph.validate(Update_stage::upload);
+
+    }
+
+    update_progress = 1.f;
+
+}
+
+
+
+//runs on the render thread, only the buffers that changed are sent again, the drawable keeps its vertex arrays
+void upload_2D_noise(){
+
+    lock_guard<mutex> lock(shape_access);
+
+    if (position_to_upload) {visual.update_position(shape.position);}
+    if (normal_to_upload) {visual.update_normal(shape.normal);}
+    if (color_to_upload) {visual.update_color(shape.color);}
+
+    if (position_to_upload || normal_to_upload || color_to_upload) {
+        visual.shading.phong = {0.3f, 0.6f, 0.05f, 64};
+    }
+
+    position_to_upload = false;
+    normal_to_upload = false;
+    color_to_upload = false;
+
 }
 
 
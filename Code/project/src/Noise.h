@@ -3,8 +3,15 @@
 #include <fstream>
 #include <iostream>
 #include <cmath>
+#include <algorithm>
 #include "vcl/vcl.hpp"
 #include "Pseudo_random_number_generator.h"
+#include "Impulse_list.h"
+#include "Gabor_kernel.h"
+#include "Impulse_cache.h"
+#include "Spectrum_engine.h"
+#include "Adaptive_quadrature.h"
+#include "Spectrum_memo.h"
 
 using namespace std;
 using namespace vcl;
@@ -18,11 +25,81 @@ class Noise {
         {
             m_kernel_radius = 1.f/m_a;
             m_impulse_density = number_of_impulses_per_kernel/(pi*pow(m_kernel_radius,2));
+            m_accuracy = Kernel_accuracy::exact;
+            m_poisson_sampler = Poisson_sampler::knuth;
+            m_integration_tolerance = 1e-3f;
         }
 
+        virtual ~Noise () {}
 
 
-        float intensity (float x, float y) {
+
+        //exact keeps the libm kernel, accurate and fast use the vectorized approximations of Gabor_kernel.h
+        //the accuracy is chosen at construction: Noise is exact, make_noise builds a Gabor_noise (Noise_variants.h) of another one
+        Kernel_accuracy kernel_accuracy () const {
+            return m_accuracy;
+        }
+
+
+
+        //keeps the impulses of the last visited cells in memory, shared by the copies of this noise
+        void enable_impulse_cache (size_t memory_budget, unsigned number_of_shards=16) {
+            m_cache = make_shared<Impulse_cache>(memory_budget, number_of_shards);
+        }
+
+        //the table sampler is faster but changes the impulses, knuth (the default) keeps the previous results
+        void set_poisson_sampler (Poisson_sampler sampler) {
+            m_poisson_sampler = sampler;
+            if (sampler == Poisson_sampler::table && !m_poisson_table) {
+                m_poisson_table = make_shared<Poisson_table const>(m_impulse_density*pow(m_kernel_radius,2));
+            }
+            if (m_cache) {m_cache->clear();}
+        }
+
+        Poisson_sampler poisson_sampler () const {
+            return m_poisson_sampler;
+        }
+
+
+
+        //relative accuracy of the integrals of variance() and power_spectrum(), the work adapts to it
+        void set_integration_tolerance (float tolerance) {
+            m_integration_tolerance = tolerance;
+            if (m_spectrum_memo) {m_spectrum_memo = make_shared<Spectrum_memo>(spectrum_engine(), m_spectrum_memo_resolution, m_spectrum_memo_extent);}
+        }
+
+        float integration_tolerance () const {
+            return m_integration_tolerance;
+        }
+
+        //keeps the pixels of the spectrum image of the given resolution and extent read by spectrum_pixel, shared by the copies of this noise
+        void enable_spectrum_memo (unsigned resolution, float extent) {
+            m_spectrum_memo_resolution = resolution;
+            m_spectrum_memo_extent = extent;
+            m_spectrum_memo = make_shared<Spectrum_memo>(spectrum_engine(), resolution, extent);
+        }
+
+        void disable_spectrum_memo () {
+            m_spectrum_memo = nullptr;
+        }
+
+        Spectrum_memo::Statistics spectrum_memo_statistics () const {
+            return m_spectrum_memo ? m_spectrum_memo->statistics() : Spectrum_memo::Statistics();
+        }
+
+
+
+        void disable_impulse_cache () {
+            m_cache = nullptr;
+        }
+
+        Impulse_cache::Statistics impulse_cache_statistics () const {
+            return m_cache ? m_cache->statistics() : Impulse_cache::Statistics();
+        }
+
+
+
+        float intensity (float x, float y) const {
 
             x = x/m_kernel_radius ;
             y = y/m_kernel_radius ;
@@ -45,7 +122,134 @@ class Noise {
 
 
 
-        float cell_noise (int i, int j, float x, float y) {
+        //evaluates intensity(x0 + px*step, y0 + py*step) for every pixel (px,py) of the tile into out[py*width + px]
+        //the impulses of each cell touching the tile are generated only once, the result is bit-identical to intensity
+        void evaluate_tile (float x0, float y0, unsigned width, unsigned height, float step, float* out) const {
+
+            vector<float> x(width);
+            for (unsigned px=0 ; px<width ; px++) {x[px] = x0 + float(px)*step;}
+
+            vector<float> y(height);
+            for (unsigned py=0 ; py<height ; py++) {y[py] = y0 + float(py)*step;}
+
+            evaluate_samples(x, y, out);
+
+        }
+
+        //intensity(x[px], y[py]) into out[py*width + px], the impulses of each cell touching the samples are generated only once
+        void evaluate_samples (vector<float> const& x, vector<float> const& y, float* out) const {
+
+            unsigned width = x.size();
+            unsigned height = y.size();
+            if (width == 0 || height == 0) {return;}
+
+            vector<int> cell_x(width);
+            vector<float> frac_x(width);
+            for (unsigned px=0 ; px<width ; px++) {
+                float xc = x[px]/m_kernel_radius;
+                cell_x[px] = floor(xc);
+                frac_x[px] = xc-floor(xc);
+            }
+
+            vector<int> cell_y(height);
+            vector<float> frac_y(height);
+            for (unsigned py=0 ; py<height ; py++) {
+                float yc = y[py]/m_kernel_radius;
+                cell_y[py] = floor(yc);
+                frac_y[py] = yc-floor(yc);
+            }
+
+            int cell_x_min = *min_element(cell_x.begin(), cell_x.end()) - 1;
+            int cell_x_max = *max_element(cell_x.begin(), cell_x.end()) + 1;
+            int cell_y_min = *min_element(cell_y.begin(), cell_y.end()) - 1;
+            int cell_y_max = *max_element(cell_y.begin(), cell_y.end()) + 1;
+            int number_of_cells_x = cell_x_max - cell_x_min + 1;
+            int number_of_cells_y = cell_y_max - cell_y_min + 1;
+
+            vector<shared_ptr<Impulse_list const>> cells(number_of_cells_x*number_of_cells_y);
+            for (int cj=0 ; cj<number_of_cells_y ; cj++) {
+                for (int ci=0 ; ci<number_of_cells_x ; ci++) {
+                    cells[cj*number_of_cells_x + ci] = cell_impulses(cell_x_min + ci, cell_y_min + cj);
+                }
+            }
+
+            for (unsigned py=0 ; py<height ; py++) {
+                for (unsigned px=0 ; px<width ; px++) {
+
+                    float noise_intensity = 0.f;
+
+                    for (int i=-1 ; i<=1 ; i++) {
+                        for (int j=-1 ; j<=1 ; j++) {
+                            Impulse_list const& impulses = *cells[(cell_y[py] + j - cell_y_min)*number_of_cells_x + (cell_x[px] + i - cell_x_min)];
+                            noise_intensity += impulses_noise(impulses, frac_x[px] - i, frac_y[py] - j);
+                        }
+                    }
+
+                    out[py*width + px] = noise_intensity;
+
+                }
+            }
+
+        }
+
+        //intensity(x[k], y[k]) into out[k] for points lying close to each other, as the vertices of a tile of a mesh,
+        //the impulses of each cell touching the points are generated only once, the result is bit-identical to intensity
+        void evaluate_points (vector<float> const& x, vector<float> const& y, float* out) const {
+
+            unsigned count = x.size();
+            if (count == 0) {return;}
+
+            vector<int> cell_x(count), cell_y(count);
+            vector<float> frac_x(count), frac_y(count);
+            for (unsigned k=0 ; k<count ; k++) {
+                float xc = x[k]/m_kernel_radius;
+                float yc = y[k]/m_kernel_radius;
+                cell_x[k] = floor(xc);
+                cell_y[k] = floor(yc);
+                frac_x[k] = xc-floor(xc);
+                frac_y[k] = yc-floor(yc);
+            }
+
+            int cell_x_min = *min_element(cell_x.begin(), cell_x.end()) - 1;
+            int cell_x_max = *max_element(cell_x.begin(), cell_x.end()) + 1;
+            int cell_y_min = *min_element(cell_y.begin(), cell_y.end()) - 1;
+            int cell_y_max = *max_element(cell_y.begin(), cell_y.end()) + 1;
+            int number_of_cells_x = cell_x_max - cell_x_min + 1;
+            int number_of_cells_y = cell_y_max - cell_y_min + 1;
+
+            vector<shared_ptr<Impulse_list const>> cells(number_of_cells_x*number_of_cells_y);
+            for (int cj=0 ; cj<number_of_cells_y ; cj++) {
+                for (int ci=0 ; ci<number_of_cells_x ; ci++) {
+                    cells[cj*number_of_cells_x + ci] = cell_impulses(cell_x_min + ci, cell_y_min + cj);
+                }
+            }
+
+            for (unsigned k=0 ; k<count ; k++) {
+
+                float noise_intensity = 0.f;
+
+                for (int i=-1 ; i<=1 ; i++) {
+                    for (int j=-1 ; j<=1 ; j++) {
+                        Impulse_list const& impulses = *cells[(cell_y[k] + j - cell_y_min)*number_of_cells_x + (cell_x[k] + i - cell_x_min)];
+                        noise_intensity += impulses_noise(impulses, frac_x[k] - i, frac_y[k] - j);
+                    }
+                }
+
+                out[k] = noise_intensity;
+
+            }
+
+        }
+
+
+
+        float cell_noise (int i, int j, float x, float y) const {
+            return impulses_noise(*cell_impulses(i, j), x, y);
+        }
+
+
+
+        unsigned cell_seed (int i, int j) const {
 
             unsigned seed;
 
@@ -54,12 +258,40 @@ class Noise {
 
             if (seed == 0) {seed = 1;}
 
+            return seed;
+
+        }
+
+
+
+        //impulses of cell (i,j), taken from the impulse cache when it is enabled
+        shared_ptr<Impulse_list const> cell_impulses (int i, int j) const {
+
+            unsigned seed = cell_seed(i, j);
+
+            if (m_cache) {
+                return m_cache->get_or_generate(seed, [this](unsigned s, Impulse_list& impulses) { generate_impulses(s, impulses); });
+            }
+
+            shared_ptr<Impulse_list> impulses = make_shared<Impulse_list>();
+            generate_impulses(seed, *impulses);
+            return impulses;
+
+        }
+
+
+
+        //draws the impulses of a cell from its seeded prng, specialized by Gabor_noise (Noise_variants.h)
+        virtual void generate_impulses (unsigned seed, Impulse_list& impulses) const {
+
             Pseudo_random_number_generator prng(seed);
 
-            float number_of_impulses_per_cell = m_impulse_density*pow(m_kernel_radius,2);
-            unsigned number_of_impulses = prng.poisson(number_of_impulses_per_cell);
+            unsigned number_of_impulses = number_of_impulses_in_cell(prng);
+            NOISE_COUNTERS_ONLY(Noise_counters::count_impulses(number_of_impulses);)
+
+            impulses.clear();
+            impulses.reserve(number_of_impulses);
 
-            float noise = 0.f;
             for (unsigned i=0 ; i<number_of_impulses ; i++) {
 
               float xi = prng.uniform_0_1();
@@ -69,19 +301,62 @@ class Noise {
               float F0i = prng.uniform(m_F0_min, m_F0_max);
               float w0i = prng.uniform(m_w0_min, m_w0_max);
 
+              impulses.push_back(xi, yi, wi, F0i, w0i);
+
+            }
+
+            if (m_accuracy != Kernel_accuracy::exact) {
+                impulses.compute_harmonics();
+            }
+
+        }
+
+
+
+        //first draw of a cell: its number of impulses
+        template <typename Generator>
+        unsigned number_of_impulses_in_cell (Generator& prng) const {
+
+            if (m_poisson_sampler == Poisson_sampler::table) {
+                return prng.poisson(*m_poisson_table);
+            }
+
+            float number_of_impulses_per_cell = m_impulse_density*pow(m_kernel_radius,2);
+            return prng.poisson(number_of_impulses_per_cell);
+
+        }
+
+
+
+        //sums the kernels of a cell's impulses at the point (x,y) given in cell coordinates
+        virtual float impulses_noise (Impulse_list const& impulses, float x, float y) const {
+
+            if (m_accuracy != Kernel_accuracy::exact) {
+                return gabor_kernel_sum(m_accuracy, m_K, m_a, m_kernel_radius, x, y, impulses);
+            }
+
+            float noise = 0.f;
+            NOISE_COUNTERS_ONLY(size_t kernel_evaluations = 0;)
+            for (size_t i=0 ; i<impulses.size() ; i++) {
+
+              float xi = impulses.x[i];
+              float yi = impulses.y[i];
+
               if ((pow(x-xi,2) + pow(y-yi,2)) < 1.f) {
-                noise += wi*gabor(m_K, m_a, F0i, w0i, (x-xi)*m_kernel_radius, (y-yi)*m_kernel_radius); // anisotropic if F0min=F0max and w0min=w0max, isotropic if F0min=F0max and w0min=0,w0max=2pi
+                NOISE_COUNTERS_ONLY(kernel_evaluations++;)
+                noise += impulses.weight[i]*gabor(m_K, m_a, impulses.F0[i], impulses.w0[i], (x-xi)*m_kernel_radius, (y-yi)*m_kernel_radius); // anisotropic if F0min=F0max and w0min=w0max, isotropic if F0min=F0max and w0min=0,w0max=2pi
               }
 
             }
 
+            NOISE_COUNTERS_ONLY(Noise_counters::count_cell(impulses.size(), kernel_evaluations);)
             return noise;
 
         }
 
 
 
-        unsigned morton (unsigned x, unsigned y) {
+        unsigned morton (unsigned x, unsigned y) const {
             unsigned z = 0;
             for (unsigned i = 0; i < (sizeof(unsigned) * CHAR_BIT); ++i) {
                 z |= ((x & (1 << i)) << i) | ((y & (1 << i)) << (i + 1));
@@ -91,31 +366,23 @@ class Noise {
 
 
 
-        float gabor (float K, float a, float F0, float w0, float x, float y) {
+        float gabor (float K, float a, float F0, float w0, float x, float y) const {
             float gaussian = K*exp( -pi*pow(a,2)*(pow(x,2) + pow(y,2)) );
             float harmonic = cos( 2.f*pi*F0*(x*cos(w0) + y*sin(w0)) );
             return gaussian*harmonic;
         }
 
 
-        float variance() {
-
-            int N_steps;
-            float dF;
-            float integral;
+        float variance() const {
 
             if (m_F0_max-m_F0_min > pow(10,-2)) {
 
-                N_steps = 100;
-                dF = (m_F0_max-m_F0_min)/float(N_steps-1);
-
-                integral = 0.f;
-                for (int Fi=0 ; Fi<N_steps ; Fi++){
-                    float F0 = float(Fi)*dF;
-                    integral += dF*(1.f + exp(-2.f*pi*pow(F0,2)/pow(m_a,2)));
-                }
+                Adaptive_quadrature quadrature(m_integration_tolerance);
+                double integral = quadrature.integrate([&](double F0) {
+                    return 1.0 + exp(-2.0*pi*F0*F0/pow(m_a,2));
+                }, m_F0_min, m_F0_max);
 
-                return integral*m_impulse_density*pow(m_K,2)/(12.f*pow(m_a,2)*(m_F0_max-m_F0_min));
+                return float(integral)*m_impulse_density*pow(m_K,2)/(12.f*pow(m_a,2)*(m_F0_max-m_F0_min));
 
             }
 
@@ -125,68 +392,168 @@ class Noise {
         }
 
 
-        float gabor_fourier_transform (float K, float a, float F0, float w0, float fx, float fy) {
+        float gabor_fourier_transform (float K, float a, float F0, float w0, float fx, float fy) const {
             return ( exp( -(pow(fx-F0*cos(w0),2) + pow(fy-F0*sin(w0),2))*pi/pow(a,2) ) + exp( -(pow(fx+F0*cos(w0),2) + pow(fy+F0*sin(w0),2))*pi/pow(a,2) ) )*K/(2.f*pow(a,2));
         }
 
 
 
-        float power_spectrum (float fx, float fy){
+        float power_spectrum (float fx, float fy) const {
+            return integrate_power_spectrum(fx, fy);
+        }
+
+
+        //pixel (x,y) of the spectrum image of the given resolution and extent, as Spectrum_engine::render gives it,
+        //from the memo when it is enabled for this image: the pixels of opposite frequencies are then evaluated once
+        float spectrum_pixel (unsigned x, unsigned y, unsigned resolution, float extent) const {
+            if (m_spectrum_memo && m_spectrum_memo->covers(resolution, extent)) {
+                return m_spectrum_memo->value(x, y);
+            }
+            return spectrum_engine().evaluate_pixel(x, y, resolution, extent);
+        }
 
-            int N_steps;
-            float dF;
-            float dw;
-            float integral;
+
+        //average of |G|^2 over the random frequencies and orientations, integrated adaptively to m_integration_tolerance
+        float integrate_power_spectrum (float fx, float fy) const {
 
             if (m_F0_max-m_F0_min <= pow(10,-2) && m_w0_max-m_w0_min <= pow(10,-2)) {
                 float G = gabor_fourier_transform(m_K, m_a, m_F0_min, m_w0_min, fx, fy);
                 return pow(fabs(G),2)*m_impulse_density/3.f;
             }
 
-            else if (m_F0_max-m_F0_min <= pow(10,-2)) {
-
-                N_steps = 100;
-                dw = (m_w0_max-m_w0_min)/float(N_steps-1);
+            Adaptive_quadrature quadrature(m_integration_tolerance);
+            double integral;
 
-                integral = 0.f;
-                for (int wi=0 ; wi<N_steps ; wi++){
-                    integral += dw*pow(fabs(gabor_fourier_transform(m_K, m_a, m_F0_min, m_w0_min + float(wi)*dw, fx, fy)),2);
-                }
+            if (m_F0_max-m_F0_min <= pow(10,-2)) {
+                integral = quadrature.integrate([&](double w0) {
+                    return pow(gabor_fourier_transform(m_K, m_a, m_F0_min, float(w0), fx, fy),2);
+                }, m_w0_min, m_w0_max, bandwidth_pieces((m_w0_max-m_w0_min)*m_F0_min));
+                return float(integral)*m_impulse_density/(3.f*(m_w0_max-m_w0_min));
+            }
 
-                return integral*m_impulse_density/(3.f*(m_w0_max-m_w0_min));
+            else if (m_w0_max-m_w0_min <= pow(10,-2)) {
+                integral = quadrature.integrate([&](double F0) {
+                    return pow(gabor_fourier_transform(m_K, m_a, float(F0), m_w0_min, fx, fy),2);
+                }, m_F0_min, m_F0_max, bandwidth_pieces(m_F0_max-m_F0_min));
+                return float(integral)*m_impulse_density/(3.f*(m_F0_max-m_F0_min));
+            }
 
+            else {
+                integral = quadrature.integrate([&](double F0, double w0) {
+                    return pow(gabor_fourier_transform(m_K, m_a, float(F0), float(w0), fx, fy),2);
+                }, m_F0_min, m_F0_max, m_w0_min, m_w0_max, 2*bandwidth_pieces(m_F0_max-m_F0_min), 2*bandwidth_pieces((m_w0_max-m_w0_min)*m_F0_max));
+                return float(integral)*m_impulse_density/(3.f*(m_F0_max-m_F0_min)*(m_w0_max-m_w0_min));
             }
 
-            else if (m_w0_max-m_w0_min <= pow(10,-2)) {
+        }
 
-                N_steps = 100;
-                dF = (m_F0_max-m_F0_min)/float(N_steps-1);
 
-                integral = 0.f;
-                for (int Fi=0 ; Fi<N_steps ; Fi++){
-                    integral += dF*pow(fabs(gabor_fourier_transform(m_K, m_a, m_F0_min + float(Fi)*dF, m_w0_min, fx, fy)),2);
-                }
+        //|G|^2 is a gaussian of width about m_a around the frequency F0*(cos(w0),sin(w0)): an integral over a range of frequencies
+        //(or of arcs, for the orientations) of the given length is first split into pieces of three times that width, twice as many
+        //for the cubature whose 17 points rule is coarser
+        unsigned bandwidth_pieces (float length) const {
+            return min(64u, max(1u, unsigned(ceil(length/(3.f*m_a)))));
+        }
+
+
+        //texture of the noise over the uv square: atlas(x,y) = intensity(uv_scale*u, uv_scale*v) at the center (u,v) of the texel,
+        //with v increasing with y; the rows are evaluated in parallel, so that the detail no longer depends on the vertices of the mesh
+        grid_2D<float> bake_uv_texture (unsigned resolution, float uv_scale, thread_pool& pool) const {
+
+            grid_2D<float> atlas(resolution, resolution);
+            float step = uv_scale/float(resolution);
+
+            unsigned rows = 8;
+            pool.run((resolution + rows - 1)/rows, [&](size_t b) {
+                unsigned y_begin = unsigned(b)*rows;
+                unsigned height = min(rows, resolution - y_begin);
+                evaluate_tile(0.5f*step, (float(y_begin) + 0.5f)*step, resolution, height, step, atlas.data.data.data() + size_t(y_begin)*resolution);
+            });
+
+            return atlas;
+
+        }
+
+
+        //same spectrum as power_spectrum, with the averages over F0 and w0 in closed form where they exist, see Spectrum_engine.h
+        Spectrum_engine spectrum_engine () const {
+            return Spectrum_engine(m_K, m_a, m_F0_min, m_F0_max, m_w0_min, m_w0_max, m_impulse_density, m_integration_tolerance);
+        }
 
-                return integral*m_impulse_density/(3.f*(m_F0_max-m_F0_min));
 
+        //complex white noise is shaped by sqrt(power_spectrum) on the frequency grid of the image, then inverse transformed:
+        //the cost is O(N log N) instead of O(N x impulses), the image has the same second-order statistics as the noise but not its impulses
+        grid_2D<float> spectral_synthesis (unsigned resolution, float step, unsigned seed, thread_pool& pool) const {
+
+            size_t N = resolution;
+            float frequency_step = 1.f/(float(N)*step);
+            float max_frequency = 0.5f/step;
+
+            //the spectrum varies on a scale of m_a, for large images it is tabulated every m_a/8 and interpolated
+            size_t M = max(size_t(64), size_t(ceil(2.f*max_frequency/(m_a/8.f))) + 2);
+            bool tabulated = (M < N);
+            float table_step = 2.f*max_frequency/float(M-1);
+
+            Spectrum_engine const engine = spectrum_engine();
+
+            grid_2D<float> table;
+            if (tabulated) {
+                table.resize(M, M);
+                pool.run(M, [&](size_t j) {
+                    for (size_t i=0 ; i<M ; i++) {
+                        table(i,j) = engine.evaluate(-max_frequency + float(i)*table_step, -max_frequency + float(j)*table_step);
+                    }
+                });
             }
 
-            else {
+            //frequency of the index k of the transform
+            auto frequency = [&](size_t k) {
+                return (k < (N+1)/2 ? float(k) : float(k) - float(N))*frequency_step;
+            };
 
-                N_steps = 30;
-                dF = (m_F0_max-m_F0_min)/float(N_steps-1);
-                dw = (m_w0_max-m_w0_min)/float(N_steps-1);
+            grid_2D<complex<float>> spectrum(N, N);
 
-                integral = 0.f;
-                for (int wi=0 ; wi<N_steps ; wi++){
-                    for (int Fi=0 ; Fi<N_steps ; Fi++){
-                        integral += dw*dF*pow(fabs(gabor_fourier_transform(m_K, m_a, m_F0_min + float(Fi)*dF, m_w0_min + float(wi)*dw, fx, fy)),2);
+            pool.run(N, [&](size_t ky) {
+
+                float fy = frequency(ky);
+
+                for (size_t kx=0 ; kx<N ; kx++) {
+
+                    float fx = frequency(kx);
+
+                    float S;
+                    if (tabulated) {
+                        float u = min((fx + max_frequency)/table_step, float(M-1) - 1e-3f);
+                        float v = min((fy + max_frequency)/table_step, float(M-1) - 1e-3f);
+                        S = interpolation_bilinear(table, max(u, 0.f), max(v, 0.f));
+                    }
+                    else {
+                        S = engine.evaluate(fx, fy);
                     }
+
+                    //the real part of the field keeps half of the energy of the complex coefficients c, so E|c|^2 = 2*S*df^2
+                    //Box-Muller: c = sqrt(2*S)*df*(g1 + i*g2)/sqrt(2), with g1, g2 independent standard normal numbers
+                    unsigned counter = unsigned(ky*N + kx);
+                    float u1 = (float(Counter_based_random_number_generator::random_at(seed, counter, 1) >> 8) + 0.5f)*(1.f/16777216.f);
+                    float u2 = float(Counter_based_random_number_generator::random_at(seed, counter, 2) >> 8)*(1.f/16777216.f);
+                    float amplitude = sqrt(max(S, 0.f))*frequency_step*sqrt(-2.f*log(u1));
+
+                    spectrum(kx, ky) = polar(amplitude, 2.f*pi*u2);
+
                 }
 
-                return integral*m_impulse_density/(3.f*(m_F0_max-m_F0_min)*(m_w0_max-m_w0_min));
+            });
 
-            }
+            inverse_fft(spectrum, pool);
+
+            grid_2D<float> image(N, N);
+            pool.run(N, [&](size_t y) {
+                for (size_t x=0 ; x<N ; x++) {
+                    image(x,y) = spectrum(x,y).real();
+                }
+            });
+
+            return image;
 
         }
 
@@ -236,7 +603,13 @@ class Noise {
 
 
 
-    private:
+    protected:
+
+        //called by the constructor of the specializations only, the harmonics of the impulses depend on the accuracy
+        void set_kernel_accuracy (Kernel_accuracy accuracy) {
+            m_accuracy = accuracy;
+        }
+
 
         float m_K;
         float m_a;
@@ -249,5 +622,13 @@ class Noise {
         unsigned m_random_offset;
         bool m_is_periodic;
         unsigned m_period;
+        Kernel_accuracy m_accuracy;
+        shared_ptr<Impulse_cache> m_cache;
+        Poisson_sampler m_poisson_sampler;
+        shared_ptr<Poisson_table const> m_poisson_table;
+        float m_integration_tolerance;
+        shared_ptr<Spectrum_memo> m_spectrum_memo;
+        unsigned m_spectrum_memo_resolution;
+        float m_spectrum_memo_extent;
 
 };
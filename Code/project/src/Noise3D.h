@@ -0,0 +1,320 @@
+#pragma once
+
+#include <fstream>
+#include <iostream>
+#include <cmath>
+#include <deque>
+#include "vcl/vcl.hpp"
+#include "Pseudo_random_number_generator.h"
+#include "Surface_impulse_grid.h"
+
+using namespace std;
+using namespace vcl;
+
+//impulses of a cell of the volume: position in the cell, weight, frequency and direction of the harmonic
+struct Volume_impulses {
+
+    vector<float> x;
+    vector<float> y;
+    vector<float> z;
+    vector<float> weight;
+    vector<float> F0;
+    vector<float> dx;
+    vector<float> dy;
+    vector<float> dz;
+
+    void resize (size_t n) {
+        x.resize(n);
+        y.resize(n);
+        z.resize(n);
+        weight.resize(n);
+        F0.resize(n);
+        dx.resize(n);
+        dy.resize(n);
+        dz.resize(n);
+    }
+
+    size_t size () const {
+        return x.size();
+    }
+
+};
+
+
+//solid Gabor noise: sum of 3D Gabor kernels K*exp(-pi*a^2*|x|^2)*cos(2*pi*F0*dot(x,d)) placed at the impulses of the 27 cells around the point,
+//with d uniform on the sphere (isotropic) and F0 uniform in [F0_min,F0_max]
+//the cells are cubes of the kernel radius 1/a, seeded as the cells of Surface_noise
+
+class Noise3D {
+
+    public:
+
+        Noise3D (float K, float a, float F0_min, float F0_max, float number_of_impulses_per_kernel, unsigned random_offset, bool is_periodic, unsigned period=256)
+        :  m_K(K), m_a(a), m_F0_min(F0_min), m_F0_max(F0_max), m_random_offset(random_offset), m_is_periodic(is_periodic), m_period(period)
+        {
+            m_kernel_radius = 1.f/m_a;
+            m_impulse_density = number_of_impulses_per_kernel/(4.f/3.f*pi*pow(m_kernel_radius,3));
+        }
+
+
+        float intensity (float x, float y, float z) const {
+
+            x = x/m_kernel_radius ;
+            y = y/m_kernel_radius ;
+            z = z/m_kernel_radius ;
+
+            float frac_x = x-floor(x);
+            float frac_y = y-floor(y);
+            float frac_z = z-floor(z);
+
+            float noise_intensity = 0.f;
+            Volume_impulses impulses;
+
+            for (int i=-1 ; i<=1 ; i++) {
+                for (int j=-1 ; j<=1 ; j++) {
+                    for (int k=-1 ; k<=1 ; k++) {
+                        draw_cell_impulses(int(floor(x)) + i, int(floor(y)) + j, int(floor(z)) + k, impulses);
+                        noise_intensity += impulses_noise(impulses, frac_x - i, frac_y - j, frac_z - k);
+                    }
+                }
+            }
+
+            return noise_intensity;
+
+        }
+
+
+        //evaluates intensity(origin + (px,py,pz)*step) plane after plane, consume(pz, plane) receives plane[py*width + px] in the order of pz
+        //the volume is swept by layers of cells: only the impulses of the 3 layers around the current plane are kept, each cell is generated once,
+        //and the memory is one plane plus 3 layers of cells whatever the depth; the rows of a plane are evaluated in parallel
+        //the result is bit-identical to intensity
+        //step has to be positive: the sweep only moves towards increasing z, the layers behind the current plane are dropped
+        template <typename Consume_plane>
+        void evaluate_planes (unsigned width, unsigned height, unsigned depth, vec3 origin, float step, thread_pool& pool, Consume_plane const& consume) const {
+
+            assert_vcl(step > 0, "The planes must be swept with a positive step");
+            if (width == 0 || height == 0 || depth == 0) {return;}
+
+            //cells along x and y of the plane, with their neighbours
+            vector<int> cell_x(width);
+            vector<float> frac_x(width);
+            for (unsigned px=0 ; px<width ; px++) {
+                float x = (origin[0] + float(px)*step)/m_kernel_radius;
+                cell_x[px] = int(floor(x));
+                frac_x[px] = x-floor(x);
+            }
+            vector<int> cell_y(height);
+            vector<float> frac_y(height);
+            for (unsigned py=0 ; py<height ; py++) {
+                float y = (origin[1] + float(py)*step)/m_kernel_radius;
+                cell_y[py] = int(floor(y));
+                frac_y[py] = y-floor(y);
+            }
+
+            int cell_x_min = *min_element(cell_x.begin(), cell_x.end()) - 1;
+            int cell_y_min = *min_element(cell_y.begin(), cell_y.end()) - 1;
+            int number_of_cells_x = *max_element(cell_x.begin(), cell_x.end()) + 1 - cell_x_min + 1;
+            int number_of_cells_y = *max_element(cell_y.begin(), cell_y.end()) + 1 - cell_y_min + 1;
+
+            deque<Cell_layer> layers; //layers of cells in increasing k
+            vector<float> plane(size_t(width)*height);
+
+            for (unsigned pz=0 ; pz<depth ; pz++) {
+
+                float z = (origin[2] + float(pz)*step)/m_kernel_radius;
+                int cell_z = int(floor(z));
+                float frac_z = z-floor(z);
+
+                //drops the layers left behind, generates the ones entered
+                while (!layers.empty() && layers.front().k < cell_z - 1) {
+                    layers.pop_front();
+                }
+                for (int k=cell_z-1 ; k<=cell_z+1 ; k++) {
+                    if (layers.empty() || layers.back().k < k) {
+                        layers.push_back(Cell_layer());
+                        generate_layer(k, cell_x_min, cell_y_min, number_of_cells_x, number_of_cells_y, layers.back(), pool);
+                    }
+                }
+                Cell_layer const* neighbours[3] = {&layers[0], &layers[1], &layers[2]};
+
+                pool.run(height, [&](size_t py) {
+                    for (unsigned px=0 ; px<width ; px++) {
+
+                        float noise_intensity = 0.f;
+
+                        for (int i=-1 ; i<=1 ; i++) {
+                            for (int j=-1 ; j<=1 ; j++) {
+                                size_t cell = size_t(cell_y[py] + j - cell_y_min)*number_of_cells_x + (cell_x[px] + i - cell_x_min);
+                                for (int k=-1 ; k<=1 ; k++) {
+                                    noise_intensity += impulses_noise(neighbours[k+1]->cells[cell], frac_x[px] - i, frac_y[py] - j, frac_z - k);
+                                }
+                            }
+                        }
+
+                        plane[py*width + px] = noise_intensity;
+
+                    }
+                });
+
+                consume(pz, plane.data());
+
+            }
+
+        }
+
+
+        //volume(px,py,pz) = intensity(origin + (px,py,pz)*step)
+        grid_3D<float> evaluate_volume (unsigned width, unsigned height, unsigned depth, vec3 origin, float step, thread_pool& pool) const {
+
+            grid_3D<float> volume(width, height, depth);
+            size_t plane_size = size_t(width)*height;
+
+            evaluate_planes(width, height, depth, origin, step, pool, [&](unsigned pz, float const* plane) {
+                copy(plane, plane + plane_size, volume.data.data.data() + pz*plane_size);
+            });
+
+            return volume;
+
+        }
+
+
+        //writes the volume of evaluate_volume to the file plane after plane, without holding it in memory:
+        //raw 32 bits floats in the byte order of the machine, x then y then z (width*height*depth*4 bytes)
+        bool save_volume (string file_name, unsigned width, unsigned height, unsigned depth, vec3 origin, float step, thread_pool& pool) const {
+
+            ofstream file(file_name, ios::binary);
+            if (!file) {
+                cout<<"cannot write the volume "<<file_name<<endl;
+                return false;
+            }
+
+            size_t plane_bytes = size_t(width)*height*sizeof(float);
+            evaluate_planes(width, height, depth, origin, step, pool, [&](unsigned, float const* plane) {
+                file.write(reinterpret_cast<char const*>(plane), plane_bytes);
+            });
+
+            return bool(file);
+
+        }
+
+
+        //density*E[w^2]*integral of the squared kernel, with E[w^2] = 1/3 and the average of exp(-2*pi*F0^2/a^2) over F0 for the harmonic
+        float variance () const {
+
+            double c = 2.0*pi/pow(double(m_a),2);
+            double harmonic_average;
+            if (m_F0_max - m_F0_min <= 1e-2f) {
+                harmonic_average = exp(-c*pow(double(m_F0_min),2));
+            }
+            else {
+                harmonic_average = 0.5*sqrt(pi/c)*(erf(sqrt(c)*m_F0_max) - erf(sqrt(c)*m_F0_min))/double(m_F0_max - m_F0_min);
+            }
+
+            double squared_kernel = pow(double(m_K),2)/2.0*pow(2.0*pow(double(m_a),2), -1.5)*(1.0 + harmonic_average);
+            return float(double(m_impulse_density)/3.0*squared_kernel);
+
+        }
+
+
+        unsigned cell_seed (int i, int j, int k) const {
+
+            unsigned seed;
+
+            if (m_is_periodic) { seed = (((unsigned)k % m_period)*m_period + ((unsigned)j % m_period))*m_period + ((unsigned)i % m_period) + m_random_offset; } //periodic noise
+            else { seed = Surface_impulse_grid::mix(Surface_impulse_grid::key(i, j, k)) + m_random_offset; } // nonperiodic noise
+
+            if (seed == 0) {seed = 1;}
+            return seed;
+
+        }
+
+
+        //impulses of the cell (i,j,k)
+        void draw_cell_impulses (int i, int j, int k, Volume_impulses& impulses) const {
+
+            Pseudo_random_number_generator prng(cell_seed(i, j, k));
+
+            float number_of_impulses_per_cell = m_impulse_density*pow(m_kernel_radius,3);
+            unsigned number_of_impulses = prng.poisson(number_of_impulses_per_cell);
+
+            impulses.resize(number_of_impulses);
+
+            for (unsigned n=0 ; n<number_of_impulses ; n++) {
+
+                impulses.x[n] = prng.uniform_0_1();
+                impulses.y[n] = prng.uniform_0_1();
+                impulses.z[n] = prng.uniform_0_1();
+                impulses.weight[n] = prng.uniform(-1,1);
+                impulses.F0[n] = prng.uniform(m_F0_min, m_F0_max);
+
+                //uniform direction on the sphere
+                float cos_theta = prng.uniform(-1,1);
+                float phi = prng.uniform(0, 2.f*pi);
+                float sin_theta = sqrt(max(0.f, 1.f - cos_theta*cos_theta));
+                impulses.dx[n] = sin_theta*cos(phi);
+                impulses.dy[n] = sin_theta*sin(phi);
+                impulses.dz[n] = cos_theta;
+
+            }
+
+        }
+
+
+        //sums the kernels of a cell's impulses at the point (x,y,z) given in cell coordinates
+        float impulses_noise (Volume_impulses const& impulses, float x, float y, float z) const {
+
+            float noise = 0.f;
+
+            for (size_t n=0 ; n<impulses.size() ; n++) {
+
+                float ox = x - impulses.x[n];
+                float oy = y - impulses.y[n];
+                float oz = z - impulses.z[n];
+                float squared_distance = ox*ox + oy*oy + oz*oz;
+
+                if (squared_distance < 1.f) {
+                    float gaussian = m_K*exp(-pi*pow(m_a*m_kernel_radius,2)*squared_distance);
+                    float harmonic = cos(2.f*pi*impulses.F0[n]*m_kernel_radius*(ox*impulses.dx[n] + oy*impulses.dy[n] + oz*impulses.dz[n]));
+                    noise += impulses.weight[n]*gaussian*harmonic;
+                }
+
+            }
+
+            return noise;
+
+        }
+
+
+    private:
+
+        //cells (cell_x_min + ci, cell_y_min + cj, k) of the volume at cells[cj*number_of_cells_x + ci]
+        struct Cell_layer {
+            int k;
+            vector<Volume_impulses> cells;
+        };
+
+        void generate_layer (int k, int cell_x_min, int cell_y_min, int number_of_cells_x, int number_of_cells_y, Cell_layer& layer, thread_pool& pool) const {
+
+            layer.k = k;
+            layer.cells.assign(size_t(number_of_cells_x)*number_of_cells_y, Volume_impulses());
+
+            pool.run(number_of_cells_y, [&](size_t cj) {
+                for (int ci=0 ; ci<number_of_cells_x ; ci++) {
+                    draw_cell_impulses(cell_x_min + ci, cell_y_min + int(cj), k, layer.cells[cj*number_of_cells_x + ci]);
+                }
+            });
+
+        }
+
+
+        float m_K;
+        float m_a;
+        float m_F0_min;
+        float m_F0_max;
+        unsigned m_random_offset;
+        bool m_is_periodic;
+        unsigned m_period;
+        float m_kernel_radius;
+        float m_impulse_density;
+
+};
@@ -0,0 +1,158 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+//counts of the work done by the evaluation of the noise, to relate the cost of a parameter set to the density and to a:
+//  cells_visited       cells whose impulses are summed at a point (9 per sample of Noise, 27 per vertex of Surface_noise)
+//  impulses_generated  impulses drawn for the cells, less than cells_visited times the impulses per cell when the cells are shared
+//  impulses_rejected   impulses of the visited cells farther than the kernel radius from the point
+//  kernel_evaluations  impulses within the kernel radius, whose kernel is evaluated
+//  poisson_iterations  uniform numbers drawn by the knuth sampler, steps of the guide table for the table sampler
+//
+//the counting statements are only compiled with NOISE_COUNTERS defined (cmake -DNOISE_COUNTERS=ON), they vanish otherwise
+//each thread adds to its own counters without synchronisation, read() merges the counters of every thread that counted
+
+#ifdef NOISE_COUNTERS
+#define NOISE_COUNTERS_ONLY(...) __VA_ARGS__
+#else
+#define NOISE_COUNTERS_ONLY(...)
+#endif
+
+struct Noise_counts {
+    uint64_t cells_visited = 0;
+    uint64_t impulses_generated = 0;
+    uint64_t impulses_rejected = 0;
+    uint64_t kernel_evaluations = 0;
+    uint64_t poisson_iterations = 0;
+};
+
+class Noise_counters {
+
+    public:
+
+        //one visited cell of the given number of impulses, kernel_evaluations of them within the kernel radius
+        static void count_cell (size_t impulses, size_t kernel_evaluations) {
+            Thread_counters& counters = local();
+            add(counters.cells_visited, 1);
+            add(counters.impulses_rejected, impulses - kernel_evaluations);
+            add(counters.kernel_evaluations, kernel_evaluations);
+        }
+
+        static void count_impulses (size_t impulses) {
+            add(local().impulses_generated, impulses);
+        }
+
+        static void count_poisson_iterations (size_t iterations) {
+            add(local().poisson_iterations, iterations);
+        }
+
+
+        //sum of the counters of all the threads since the last reset
+        static Noise_counts read () {
+            Noise_counts total = totals();
+            Noise_counts const& zero = baseline();
+            lock_guard<mutex> lock(registry_mutex());
+            total.cells_visited -= zero.cells_visited;
+            total.impulses_generated -= zero.impulses_generated;
+            total.impulses_rejected -= zero.impulses_rejected;
+            total.kernel_evaluations -= zero.kernel_evaluations;
+            total.poisson_iterations -= zero.poisson_iterations;
+            return total;
+        }
+
+        //the counters of the threads are left untouched, so that it does not race with them, the current totals become the zero
+        static void reset () {
+            Noise_counts total = totals();
+            lock_guard<mutex> lock(registry_mutex());
+            baseline() = total;
+        }
+
+
+        //counts and ratios, parameters being a description of the noise they were measured on
+        static bool write_json (string const& file_name, string const& parameters) {
+
+            Noise_counts counts = read();
+            double rejected_fraction = counts.impulses_rejected + counts.kernel_evaluations > 0 ? double(counts.impulses_rejected)/double(counts.impulses_rejected + counts.kernel_evaluations) : 0.0;
+            double kernels_per_cell = counts.cells_visited > 0 ? double(counts.kernel_evaluations)/double(counts.cells_visited) : 0.0;
+
+            ofstream file(file_name);
+            file<<"{\n";
+            file<<"  \"parameters\": \""<<parameters<<"\",\n";
+            file<<"  \"cells_visited\": "<<counts.cells_visited<<",\n";
+            file<<"  \"impulses_generated\": "<<counts.impulses_generated<<",\n";
+            file<<"  \"impulses_rejected\": "<<counts.impulses_rejected<<",\n";
+            file<<"  \"kernel_evaluations\": "<<counts.kernel_evaluations<<",\n";
+            file<<"  \"poisson_iterations\": "<<counts.poisson_iterations<<",\n";
+            file<<"  \"rejected_fraction\": "<<rejected_fraction<<",\n";
+            file<<"  \"kernel_evaluations_per_cell\": "<<kernels_per_cell<<"\n";
+            file<<"}\n";
+            return bool(file);
+
+        }
+
+
+    private:
+
+        //written by its thread only, atomic so that read() can load the values while the thread counts
+        struct Thread_counters {
+            atomic<uint64_t> cells_visited{0};
+            atomic<uint64_t> impulses_generated{0};
+            atomic<uint64_t> impulses_rejected{0};
+            atomic<uint64_t> kernel_evaluations{0};
+            atomic<uint64_t> poisson_iterations{0};
+        };
+
+        static void add (atomic<uint64_t>& counter, uint64_t value) {
+            counter.store(counter.load(memory_order_relaxed) + value, memory_order_relaxed);
+        }
+
+        //the counters of a thread are registered on its first count and kept after it ends
+        static Thread_counters& local () {
+            thread_local shared_ptr<Thread_counters> counters = register_thread();
+            return *counters;
+        }
+
+        static shared_ptr<Thread_counters> register_thread () {
+            shared_ptr<Thread_counters> counters = make_shared<Thread_counters>();
+            lock_guard<mutex> lock(registry_mutex());
+            registry().push_back(counters);
+            return counters;
+        }
+
+        static Noise_counts totals () {
+            Noise_counts total;
+            lock_guard<mutex> lock(registry_mutex());
+            for (shared_ptr<Thread_counters> const& counters : registry()) {
+                total.cells_visited += counters->cells_visited.load(memory_order_relaxed);
+                total.impulses_generated += counters->impulses_generated.load(memory_order_relaxed);
+                total.impulses_rejected += counters->impulses_rejected.load(memory_order_relaxed);
+                total.kernel_evaluations += counters->kernel_evaluations.load(memory_order_relaxed);
+                total.poisson_iterations += counters->poisson_iterations.load(memory_order_relaxed);
+            }
+            return total;
+        }
+
+        static vector<shared_ptr<Thread_counters>>& registry () {
+            static vector<shared_ptr<Thread_counters>> threads;
+            return threads;
+        }
+
+        static Noise_counts& baseline () {
+            static Noise_counts zero;
+            return zero;
+        }
+
+        static mutex& registry_mutex () {
+            static mutex registry_access;
+            return registry_access;
+        }
+
+};
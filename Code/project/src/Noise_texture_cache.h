@@ -0,0 +1,181 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "vcl/vcl.hpp"
+
+using namespace std;
+using namespace vcl;
+
+//parameters of a noise texture baked in uv space, the key of the cache
+
+struct Noise_texture_parameters {
+
+    float K;
+    float a;
+    float F0_min;
+    float F0_max;
+    float w0_min;
+    float w0_max;
+    float number_of_impulses_per_kernel;
+    unsigned random_offset;
+    bool is_periodic;
+    unsigned resolution;
+    float uv_scale;
+
+    bool operator== (Noise_texture_parameters const& other) const {
+        return K == other.K && a == other.a && F0_min == other.F0_min && F0_max == other.F0_max && w0_min == other.w0_min && w0_max == other.w0_max
+            && number_of_impulses_per_kernel == other.number_of_impulses_per_kernel && random_offset == other.random_offset
+            && is_periodic == other.is_periodic && resolution == other.resolution && uv_scale == other.uv_scale;
+    }
+
+};
+
+
+//baked noise textures saved on disk, one file per set of parameters named after their hash
+//a file starts with its parameters, so that a hash collision or a file of another version is ignored instead of loaded
+//an index file lists the saved textures, most recently used first, only the max_files first ones are kept on disk
+
+class Noise_texture_cache {
+
+    public:
+
+        Noise_texture_cache (string const& folder, unsigned max_files=4)
+        :  m_folder(folder), m_max_files(max_files)
+        {}
+
+
+        string file_name (Noise_texture_parameters const& parameters) const {
+
+            //FNV-1a of the parameters
+            uint64_t hash = 14695981039346656037ull;
+            auto add = [&](void const* value, size_t size) {
+                unsigned char const* bytes = static_cast<unsigned char const*>(value);
+                for (size_t i=0 ; i<size ; i++) {
+                    hash = (hash ^ bytes[i])*1099511628211ull;
+                }
+            };
+            add(&parameters.K, sizeof(float));
+            add(&parameters.a, sizeof(float));
+            add(&parameters.F0_min, sizeof(float));
+            add(&parameters.F0_max, sizeof(float));
+            add(&parameters.w0_min, sizeof(float));
+            add(&parameters.w0_max, sizeof(float));
+            add(&parameters.number_of_impulses_per_kernel, sizeof(float));
+            add(&parameters.random_offset, sizeof(unsigned));
+            add(&parameters.is_periodic, sizeof(bool));
+            add(&parameters.resolution, sizeof(unsigned));
+            add(&parameters.uv_scale, sizeof(float));
+
+            ostringstream name;
+            name<<m_folder<<"noise_texture_"<<hex<<hash<<".bin";
+            return name.str();
+
+        }
+
+
+        //false if the texture of these parameters has not been saved
+        bool load (Noise_texture_parameters const& parameters, grid_2D<float>& atlas) const {
+
+            ifstream file(file_name(parameters), ios::binary);
+            if (!file) {return false;}
+
+            char header[8];
+            Noise_texture_parameters saved;
+            file.read(header, sizeof(header));
+            read(file, saved);
+            if (!file || memcmp(header, magic(), sizeof(header)) != 0 || !(saved == parameters)) {return false;}
+
+            atlas.resize(parameters.resolution, parameters.resolution);
+            file.read(reinterpret_cast<char*>(atlas.data.data.data()), streamsize(atlas.size()*sizeof(float)));
+            if (!file) {return false;}
+
+            use(file_name(parameters));
+            return true;
+
+        }
+
+
+        void save (Noise_texture_parameters const& parameters, grid_2D<float> const& atlas) const {
+
+            ofstream file(file_name(parameters), ios::binary);
+            if (!file) {
+                cout<<"the noise texture cannot be saved in "<<m_folder<<endl;
+                return;
+            }
+
+            file.write(magic(), 8);
+            write(file, parameters);
+            file.write(reinterpret_cast<char const*>(atlas.data.data.data()), streamsize(atlas.size()*sizeof(float)));
+            file.close();
+
+            use(file_name(parameters));
+
+        }
+
+
+    private:
+
+        string index_file_name () const {
+            return m_folder + "noise_texture_index.txt";
+        }
+
+        //puts the texture first in the index, the textures after the m_max_files first ones are deleted
+        void use (string const& texture_file_name) const {
+
+            vector<string> names;
+            ifstream index(index_file_name());
+            for (string name ; getline(index, name) ; ) {
+                if (!name.empty() && name != texture_file_name) {names.push_back(name);}
+            }
+            index.close();
+
+            names.insert(names.begin(), texture_file_name);
+            while (names.size() > max(m_max_files, 1u)) {
+                std::remove(names.back().c_str());
+                names.pop_back();
+            }
+
+            ofstream updated(index_file_name());
+            for (string const& name : names) {updated<<name<<"\n";}
+
+        }
+
+        //field by field, the padding of the struct is not written
+        template <typename T>
+        static void read_field (ifstream& file, T& value) {
+            file.read(reinterpret_cast<char*>(&value), sizeof(T));
+        }
+
+        template <typename T>
+        static void write_field (ofstream& file, T const& value) {
+            file.write(reinterpret_cast<char const*>(&value), sizeof(T));
+        }
+
+        static void read (ifstream& file, Noise_texture_parameters& p) {
+            read_field(file, p.K); read_field(file, p.a); read_field(file, p.F0_min); read_field(file, p.F0_max);
+            read_field(file, p.w0_min); read_field(file, p.w0_max); read_field(file, p.number_of_impulses_per_kernel);
+            read_field(file, p.random_offset); read_field(file, p.is_periodic); read_field(file, p.resolution); read_field(file, p.uv_scale);
+        }
+
+        static void write (ofstream& file, Noise_texture_parameters const& p) {
+            write_field(file, p.K); write_field(file, p.a); write_field(file, p.F0_min); write_field(file, p.F0_max);
+            write_field(file, p.w0_min); write_field(file, p.w0_max); write_field(file, p.number_of_impulses_per_kernel);
+            write_field(file, p.random_offset); write_field(file, p.is_periodic); write_field(file, p.resolution); write_field(file, p.uv_scale);
+        }
+
+        //first bytes of the files, changed with their format
+        static char const* magic () {
+            return "GABORUV1";
+        }
+
+        string m_folder;
+        unsigned m_max_files;
+
+};
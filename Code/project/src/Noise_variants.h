@@ -0,0 +1,207 @@
+#pragma once
+
+#include <memory>
+#include "Noise.h"
+
+using namespace std;
+using namespace vcl;
+
+//Compile-time specialized Noise: the policies fix which parameters are random and which kernel evaluates the impulses
+//  anisotropic : Constant_orientation, Constant_frequency
+//  isotropic   : Random_orientation, Constant_frequency
+//  banded      : Random_orientation or Constant_orientation, Random_frequency
+//A constant parameter is not drawn but skipped in the prng stream, so the impulses are the same as the ones of Noise,
+//and its direction vector 2*pi*F0*(cos(w0),sin(w0)) is computed once instead of per impulse.
+//With Exact_kernel and Pseudo_random_number_generator the results stay bit-identical to Noise.
+//With Counter_based_random_number_generator each impulse parameter is drawn from its own stream, in batches.
+
+struct Constant_orientation { static constexpr bool is_constant = true; };
+struct Random_orientation { static constexpr bool is_constant = false; };
+
+struct Constant_frequency { static constexpr bool is_constant = true; };
+struct Random_frequency { static constexpr bool is_constant = false; };
+
+struct Exact_kernel { static constexpr Kernel_accuracy accuracy = Kernel_accuracy::exact; };
+struct Accurate_kernel { static constexpr Kernel_accuracy accuracy = Kernel_accuracy::accurate; };
+struct Fast_kernel { static constexpr Kernel_accuracy accuracy = Kernel_accuracy::fast; };
+
+
+template <typename Orientation_policy, typename Frequency_policy, typename Kernel_policy, typename Generator = Pseudo_random_number_generator>
+class Gabor_noise : public Noise {
+
+    public:
+
+        Gabor_noise (float K, float a, float F0_min, float F0_max, float w0_min, float w0_max, float number_of_impulses_per_kernel, unsigned random_offset, bool is_periodic, unsigned period=256.f)
+        :  Noise(K, a, F0_min, F0_max, w0_min, w0_max, number_of_impulses_per_kernel, random_offset, is_periodic, period)
+        {
+            set_kernel_accuracy(Kernel_policy::accuracy);
+            m_two_pi_F0 = 2.f*pi*m_F0_min;
+            m_direction_x = cos(m_w0_min);
+            m_direction_y = sin(m_w0_min);
+        }
+
+
+
+        void generate_impulses (unsigned seed, Impulse_list& impulses) const override {
+
+            Generator prng(seed);
+
+            unsigned number_of_impulses = number_of_impulses_in_cell(prng);
+            NOISE_COUNTERS_ONLY(Noise_counters::count_impulses(number_of_impulses);)
+            draw_impulses(prng, number_of_impulses, impulses);
+
+            if (Kernel_policy::accuracy != Kernel_accuracy::exact) {
+                compute_harmonics(impulses);
+            }
+
+        }
+
+
+
+        float impulses_noise (Impulse_list const& impulses, float x, float y) const override {
+
+            if (Kernel_policy::accuracy != Kernel_accuracy::exact) {
+                return gabor_kernel_sum(Kernel_policy::accuracy, m_K, m_a, m_kernel_radius, x, y, impulses);
+            }
+
+            if (!Orientation_policy::is_constant || !Frequency_policy::is_constant) {
+                return Noise::impulses_noise(impulses, x, y);
+            }
+
+            //same operations as gabor, with cos(w0), sin(w0) and 2*pi*F0 folded
+            float noise = 0.f;
+            NOISE_COUNTERS_ONLY(size_t kernel_evaluations = 0;)
+            for (size_t i=0 ; i<impulses.size() ; i++) {
+
+              float xi = impulses.x[i];
+              float yi = impulses.y[i];
+
+              if ((pow(x-xi,2) + pow(y-yi,2)) < 1.f) {
+                NOISE_COUNTERS_ONLY(kernel_evaluations++;)
+                float dx = (x-xi)*m_kernel_radius;
+                float dy = (y-yi)*m_kernel_radius;
+                float gaussian = m_K*exp( -pi*pow(m_a,2)*(pow(dx,2) + pow(dy,2)) );
+                float harmonic = cos( m_two_pi_F0*(dx*m_direction_x + dy*m_direction_y) );
+                noise += impulses.weight[i]*(gaussian*harmonic);
+              }
+
+            }
+
+            NOISE_COUNTERS_ONLY(Noise_counters::count_cell(impulses.size(), kernel_evaluations);)
+            return noise;
+
+        }
+
+
+    private:
+
+        //the sequential generator draws the parameters impulse after impulse, constant ones are skipped
+        void draw_impulses (Pseudo_random_number_generator& prng, unsigned number_of_impulses, Impulse_list& impulses) const {
+
+            impulses.clear();
+            impulses.reserve(number_of_impulses);
+
+            for (unsigned i=0 ; i<number_of_impulses ; i++) {
+
+              float xi = prng.uniform_0_1();
+              float yi = prng.uniform_0_1();
+              float wi = prng.uniform(-1,1);
+
+              float F0i = m_F0_min;
+              if (Frequency_policy::is_constant) { prng.skip(); }
+              else { F0i = prng.uniform(m_F0_min, m_F0_max); }
+
+              float w0i = m_w0_min;
+              if (Orientation_policy::is_constant) { prng.skip(); }
+              else { w0i = prng.uniform(m_w0_min, m_w0_max); }
+
+              impulses.push_back(xi, yi, wi, F0i, w0i);
+
+            }
+
+        }
+
+
+        //the counter-based generator fills each parameter of all the impulses from its own stream
+        void draw_impulses (Counter_based_random_number_generator& prng, unsigned number_of_impulses, Impulse_list& impulses) const {
+
+            impulses.clear();
+            impulses.resize(number_of_impulses);
+
+            prng.uniform_batch(1, number_of_impulses, 0.f, 1.f, impulses.x.data());
+            prng.uniform_batch(2, number_of_impulses, 0.f, 1.f, impulses.y.data());
+            prng.uniform_batch(3, number_of_impulses, -1.f, 1.f, impulses.weight.data());
+
+            if (Frequency_policy::is_constant) { fill(impulses.F0.begin(), impulses.F0.end(), m_F0_min); }
+            else { prng.uniform_batch(4, number_of_impulses, m_F0_min, m_F0_max, impulses.F0.data()); }
+
+            if (Orientation_policy::is_constant) { fill(impulses.w0.begin(), impulses.w0.end(), m_w0_min); }
+            else { prng.uniform_batch(5, number_of_impulses, m_w0_min, m_w0_max, impulses.w0.data()); }
+
+        }
+
+
+        void compute_harmonics (Impulse_list& impulses) const {
+
+            if (!Orientation_policy::is_constant) {
+                impulses.compute_harmonics();
+                return;
+            }
+
+            impulses.harmonic_x.resize(impulses.size());
+            impulses.harmonic_y.resize(impulses.size());
+            for (size_t i=0 ; i<impulses.size() ; i++) {
+                float two_pi_F0 = Frequency_policy::is_constant ? m_two_pi_F0 : 2.f*pi*impulses.F0[i];
+                impulses.harmonic_x[i] = two_pi_F0*m_direction_x;
+                impulses.harmonic_y[i] = two_pi_F0*m_direction_y;
+            }
+
+        }
+
+        float m_two_pi_F0;
+        float m_direction_x;
+        float m_direction_y;
+
+};
+
+
+
+template <typename Orientation_policy, typename Frequency_policy, typename Kernel_policy>
+shared_ptr<Noise> make_noise_with_generator (Random_generator generator, float K, float a, float F0_min, float F0_max, float w0_min, float w0_max, float number_of_impulses_per_kernel, unsigned random_offset, bool is_periodic) {
+    switch (generator) {
+        case Random_generator::counter_based: return make_shared<Gabor_noise<Orientation_policy, Frequency_policy, Kernel_policy, Counter_based_random_number_generator>>(K, a, F0_min, F0_max, w0_min, w0_max, number_of_impulses_per_kernel, random_offset, is_periodic);
+        default: return make_shared<Gabor_noise<Orientation_policy, Frequency_policy, Kernel_policy, Pseudo_random_number_generator>>(K, a, F0_min, F0_max, w0_min, w0_max, number_of_impulses_per_kernel, random_offset, is_periodic);
+    }
+}
+
+
+template <typename Orientation_policy, typename Frequency_policy>
+shared_ptr<Noise> make_noise_with_kernel (Kernel_accuracy accuracy, Random_generator generator, float K, float a, float F0_min, float F0_max, float w0_min, float w0_max, float number_of_impulses_per_kernel, unsigned random_offset, bool is_periodic) {
+    switch (accuracy) {
+        case Kernel_accuracy::accurate: return make_noise_with_generator<Orientation_policy, Frequency_policy, Accurate_kernel>(generator, K, a, F0_min, F0_max, w0_min, w0_max, number_of_impulses_per_kernel, random_offset, is_periodic);
+        case Kernel_accuracy::fast: return make_noise_with_generator<Orientation_policy, Frequency_policy, Fast_kernel>(generator, K, a, F0_min, F0_max, w0_min, w0_max, number_of_impulses_per_kernel, random_offset, is_periodic);
+        default: return make_noise_with_generator<Orientation_policy, Frequency_policy, Exact_kernel>(generator, K, a, F0_min, F0_max, w0_min, w0_max, number_of_impulses_per_kernel, random_offset, is_periodic);
+    }
+}
+
+
+//picks the specialization matching the parameters, a range is constant only when its bounds are equal
+inline shared_ptr<Noise> make_noise (float K, float a, float F0_min, float F0_max, float w0_min, float w0_max, float number_of_impulses_per_kernel, unsigned random_offset, bool is_periodic, Kernel_accuracy accuracy = Kernel_accuracy::exact, Random_generator generator = Random_generator::sequential) {
+
+    bool constant_orientation = (w0_min == w0_max);
+    bool constant_frequency = (F0_min == F0_max);
+
+    if (constant_orientation && constant_frequency) {
+        return make_noise_with_kernel<Constant_orientation, Constant_frequency>(accuracy, generator, K, a, F0_min, F0_max, w0_min, w0_max, number_of_impulses_per_kernel, random_offset, is_periodic);
+    }
+    else if (constant_orientation) {
+        return make_noise_with_kernel<Constant_orientation, Random_frequency>(accuracy, generator, K, a, F0_min, F0_max, w0_min, w0_max, number_of_impulses_per_kernel, random_offset, is_periodic);
+    }
+    else if (constant_frequency) {
+        return make_noise_with_kernel<Random_orientation, Constant_frequency>(accuracy, generator, K, a, F0_min, F0_max, w0_min, w0_max, number_of_impulses_per_kernel, random_offset, is_periodic);
+    }
+    else {
+        return make_noise_with_kernel<Random_orientation, Random_frequency>(accuracy, generator, K, a, F0_min, F0_max, w0_min, w0_max, number_of_impulses_per_kernel, random_offset, is_periodic);
+    }
+
+}
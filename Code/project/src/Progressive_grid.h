@@ -0,0 +1,159 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <vector>
+#include "vcl/vcl.hpp"
+#include "Cancellation_token.h"
+
+using namespace std;
+using namespace vcl;
+
+//evaluates a width x height grid of samples from coarse to fine: every 8th sample in both directions first, then every 4th, 2nd, and all of them
+//each sample is evaluated once, and once a level is done the samples not evaluated yet are bilinearly interpolated from it,
+//so that the grid can be shown after any call to refine
+//values()[y*width + x] is the sample (x,y)
+
+class Progressive_grid {
+
+    public:
+
+        Progressive_grid (unsigned width, unsigned height, unsigned coarsest_step=8)
+        :  m_width(width), m_height(height), m_step(max(coarsest_step, 1u)), m_coarsest_step(max(coarsest_step, 1u)), m_next_row(0), m_evaluated(0), m_values(width*height, 0.f)
+        {}
+
+
+        //evaluate_row(x_begin, y, count, x_step, out) writes the samples (x_begin + k*x_step, y) to out[k] for k<count
+        //rows of the current level are evaluated in parallel, batch after batch, until budget_ms milliseconds are spent,
+        //at least one batch is evaluated per call; returns true once every sample has been evaluated
+        //rows are skipped once the cancellation token, if any, is cancelled: the grid is then incomplete and has to be discarded
+        template <typename Evaluate_row>
+        bool refine (Evaluate_row const& evaluate_row, float budget_ms, thread_pool& pool, Cancellation_token const* cancellation = nullptr) {
+
+            auto start = chrono::steady_clock::now();
+
+            while (!complete()) {
+
+                unsigned number_of_rows = (m_height + m_step - 1)/m_step;
+                unsigned batch = min(number_of_rows - m_next_row, pool.size());
+
+                pool.run(batch, [&](size_t k) {
+
+                    if (cancellation && cancellation->cancelled()) {return;}
+
+                    unsigned y = (m_next_row + unsigned(k))*m_step;
+
+                    //the rows of the coarser level already hold every other sample
+                    bool coarser_row = (m_step < m_coarsest_step) && (y % (2*m_step) == 0);
+                    unsigned x_begin = coarser_row ? m_step : 0;
+                    unsigned x_step = coarser_row ? 2*m_step : m_step;
+                    if (x_begin >= m_width) {return;}
+                    unsigned count = (m_width - x_begin + x_step - 1)/x_step;
+
+                    vector<float> row(count);
+                    evaluate_row(x_begin, y, count, x_step, row.data());
+                    for (unsigned i=0 ; i<count ; i++) {
+                        m_values[size_t(y)*m_width + x_begin + i*x_step] = row[i];
+                    }
+
+                });
+
+                for (unsigned k=0 ; k<batch ; k++) {
+                    m_evaluated += number_of_samples_in_row((m_next_row + k)*m_step);
+                }
+                m_next_row += batch;
+
+                if (cancellation && cancellation->cancelled()) {return false;}
+
+                if (m_next_row == number_of_rows) {
+                    interpolate();
+                    m_next_row = 0;
+                    m_step = (m_step == 1) ? 0 : m_step/2;
+                }
+
+                if (chrono::duration<float, milli>(chrono::steady_clock::now() - start).count() >= budget_ms) {break;}
+
+            }
+
+            return complete();
+
+        }
+
+
+        bool complete () const {
+            return m_step == 0;
+        }
+
+
+        //spacing of the samples of the level being evaluated, 0 once complete
+        unsigned step () const {
+            return m_step;
+        }
+
+
+        //fraction of the samples evaluated
+        float progress () const {
+            return float(m_evaluated)/float(max(size_t(1), m_values.size()));
+        }
+
+
+        vector<float> const& values () const {
+            return m_values;
+        }
+
+
+    private:
+
+        unsigned number_of_samples_in_row (unsigned y) const {
+            bool coarser_row = (m_step < m_coarsest_step) && (y % (2*m_step) == 0);
+            unsigned x_begin = coarser_row ? m_step : 0;
+            unsigned x_step = coarser_row ? 2*m_step : m_step;
+            return x_begin >= m_width ? 0 : (m_width - x_begin + x_step - 1)/x_step;
+        }
+
+
+        //fills the samples between the ones of the level just finished, the border ones past the last sample of the level are held constant
+        void interpolate () {
+
+            unsigned s = m_step;
+            if (s == 1) {return;}
+
+            unsigned last_x = ((m_width - 1)/s)*s;
+            unsigned last_y = ((m_height - 1)/s)*s;
+
+            for (unsigned y=0 ; y<m_height ; y++) {
+
+                unsigned y0 = min((y/s)*s, last_y);
+                unsigned y1 = min(y0 + s, last_y);
+                float ty = (y1 == y0) ? 0.f : float(y - y0)/float(s);
+
+                for (unsigned x=0 ; x<m_width ; x++) {
+
+                    if (x % s == 0 && y % s == 0) {continue;}
+
+                    unsigned x0 = min((x/s)*s, last_x);
+                    unsigned x1 = min(x0 + s, last_x);
+                    float tx = (x1 == x0) ? 0.f : float(x - x0)/float(s);
+
+                    float v00 = m_values[size_t(y0)*m_width + x0];
+                    float v10 = m_values[size_t(y0)*m_width + x1];
+                    float v01 = m_values[size_t(y1)*m_width + x0];
+                    float v11 = m_values[size_t(y1)*m_width + x1];
+
+                    m_values[size_t(y)*m_width + x] = (1.f-ty)*((1.f-tx)*v00 + tx*v10) + ty*((1.f-tx)*v01 + tx*v11);
+
+                }
+
+            }
+
+        }
+
+        unsigned m_width;
+        unsigned m_height;
+        unsigned m_step;
+        unsigned m_coarsest_step;
+        unsigned m_next_row;
+        size_t m_evaluated;
+        vector<float> m_values;
+
+};
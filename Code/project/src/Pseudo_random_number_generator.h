@@ -3,30 +3,88 @@
 #include <fstream>
 #include <iostream>
 #include <cmath>
+#include <climits>
+#include <vector>
+#include "Noise_counters.h"
 
 using namespace std;
 
-class Pseudo_random_number_generator {
+
+
+//knuth : multiplication method, draws about mean+1 numbers (the original sampler, kept for reproducibility)
+//table : inverse of the cumulative distribution precomputed for a fixed mean, draws a single number
+enum class Poisson_sampler { knuth, table };
+
+
+//sequential    : Pseudo_random_number_generator, the original stream
+//counter_based : Counter_based_random_number_generator, random access and batch draws
+enum class Random_generator { sequential, counter_based };
+
+
+//cumulative distribution of the Poisson law of a given mean, with a guide table so that sampling costs O(1) on average
+class Poisson_table {
 
     public:
 
-        Pseudo_random_number_generator (unsigned seed = 0.f) {
-            m_x = seed;
+        Poisson_table (float mean)
+        :  m_mean(mean)
+        {
+            //cumulative probabilities until the remaining tail is negligible
+            unsigned max_count = unsigned(mean + 20.f*sqrt(mean) + 30.f);
+            double probability = exp(-double(mean));
+            double cumulative = probability;
+            m_cdf.push_back(cumulative);
+            for (unsigned k=1 ; k<=max_count && cumulative < 1.0 - 1e-12 ; k++) {
+                probability *= double(mean)/double(k);
+                cumulative += probability;
+                m_cdf.push_back(cumulative);
+            }
+
+            //m_guide[g] is the smallest count whose cumulative probability reaches g/size
+            unsigned size = m_cdf.size();
+            m_guide.resize(size);
+            unsigned k = 0;
+            for (unsigned g=0 ; g<size ; g++) {
+                while (k+1 < size && m_cdf[k] < double(g)/double(size)) {k++;}
+                m_guide[g] = k;
+            }
         }
 
-        unsigned& x () {
-            return m_x;
+
+        //count of the law for a uniform number u in [0,1]
+        unsigned sample (float u) const {
+            unsigned size = m_cdf.size();
+            unsigned g = unsigned(double(u)*size);
+            unsigned k = m_guide[g < size ? g : size-1];
+            NOISE_COUNTERS_ONLY(unsigned first = k;)
+            while (k+1 < size && double(u) > m_cdf[k]) {k++;}
+            NOISE_COUNTERS_ONLY(Noise_counters::count_poisson_iterations(k - first + 1);)
+            return k;
         }
 
 
-        unsigned next () {
-            m_x *= 3039177861u;
-            return m_x;
+        float mean () const {
+            return m_mean;
         }
 
 
+    private:
+
+        float m_mean;
+        vector<double> m_cdf;
+        vector<unsigned> m_guide;
+
+};
+
+//distributions shared by the generators, drawn from the sequence of unsigned numbers returned by Generator::next()
+
+template <typename Generator>
+class Random_distributions {
+
+    public:
+
         float uniform_0_1 () {
-            return float(next()) / float(UINT_MAX);
+            return float(generator().next()) / float(UINT_MAX);
         }
 
 
@@ -46,12 +104,136 @@ class Pseudo_random_number_generator {
                 t *= uniform_0_1();
             }
 
+            NOISE_COUNTERS_ONLY(Noise_counters::count_poisson_iterations(alpha + 1);)
             return alpha;
         }
 
 
+        unsigned poisson (Poisson_table const& table) {
+            return table.sample(uniform_0_1());
+        }
+
+
+    private:
+
+        Generator& generator () {
+            return static_cast<Generator&>(*this);
+        }
+
+};
+
+
+
+//multiplicative congruential generator: the numbers can only be produced in order
+
+class Pseudo_random_number_generator : public Random_distributions<Pseudo_random_number_generator> {
+
+    public:
+
+        static constexpr bool is_counter_based = false;
+
+        Pseudo_random_number_generator (unsigned seed = 0.f) {
+            m_x = seed;
+        }
+
+        unsigned& x () {
+            return m_x;
+        }
+
+
+        unsigned next () {
+            m_x *= 3039177861u;
+            return m_x;
+        }
+
+
+        //advances the stream as if n numbers had been drawn
+        void skip (unsigned n = 1) {
+            for (unsigned i=0 ; i<n ; i++) {
+                m_x *= 3039177861u;
+            }
+        }
+
+
     private:
 
         unsigned m_x;
 
 };
+
+
+
+//counter-based generator (Philox2x32-10): number n of stream s is computed directly from (seed, n, s),
+//so the impulses of a cell can be drawn in any order and in batches, one stream per impulse parameter
+//next() reads stream 0 in order, so the distributions and the poisson draw work as with Pseudo_random_number_generator
+
+class Counter_based_random_number_generator : public Random_distributions<Counter_based_random_number_generator> {
+
+    public:
+
+        static constexpr bool is_counter_based = true;
+
+        Counter_based_random_number_generator (unsigned seed = 0)
+        :  m_seed(seed), m_counter(0)
+        {}
+
+
+        static unsigned random_at (unsigned seed, unsigned counter, unsigned stream = 0) {
+
+            unsigned long long const multiplier = 0xD256D193u;
+            unsigned c0 = counter;
+            unsigned c1 = stream;
+            unsigned key = seed;
+
+            for (int round=0 ; round<10 ; round++) {
+                unsigned long long product = multiplier*c0;
+                c0 = unsigned(product >> 32) ^ key ^ c1;
+                c1 = unsigned(product);
+                key += 0x9E3779B9u;
+            }
+
+            return c0;
+
+        }
+
+
+        unsigned next () {
+            return random_at(m_seed, m_counter++);
+        }
+
+
+        void skip (unsigned n = 1) {
+            m_counter += n;
+        }
+
+
+        //out[k] = uniform number in [min,max) of counter k of the stream, for k<count
+        //the numbers are independent, the loop is processed in blocks of 8 lanes that the compiler vectorizes
+        void uniform_batch (unsigned stream, unsigned count, float min, float max, float* out) const {
+
+            unsigned const lanes = 8;
+            unsigned k = 0;
+
+            for ( ; k+lanes<=count ; k+=lanes) {
+                unsigned bits[lanes];
+                for (unsigned l=0 ; l<lanes ; l++) {
+                    bits[l] = random_at(m_seed, k+l, stream);
+                }
+                for (unsigned l=0 ; l<lanes ; l++) {
+                    out[k+l] = min + (float(int(bits[l] >> 8))*(1.f/16777216.f))*(max - min);
+                }
+            }
+
+            for ( ; k<count ; k++) {
+                out[k] = min + (float(int(random_at(m_seed, k, stream) >> 8))*(1.f/16777216.f))*(max - min);
+            }
+
+        }
+
+
+    private:
+
+        unsigned m_seed;
+        unsigned m_counter;
+
+};
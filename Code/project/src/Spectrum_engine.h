@@ -0,0 +1,253 @@
+#pragma once
+
+#include <cmath>
+#include <vector>
+#include <algorithm>
+#include "vcl/vcl.hpp"
+#include "Adaptive_quadrature.h"
+
+using namespace std;
+using namespace vcl;
+
+//power spectrum of the Gabor noise, computed from the expansion of |G|^2 with c = 2*pi/a^2:
+//  |G(f)|^2 = (K/(2a^2))^2 * ( exp(-c|f-mu|^2) + exp(-c|f+mu|^2) + 2*exp(-c(|f|^2 + F0^2)) ),  mu = F0*(cos(w0),sin(w0))
+//averaged over the random frequencies and orientations:
+//  - over F0 in [F0_min,F0_max] the gaussians integrate in closed form with erf
+//  - over a full turn (or half turn) of w0 they integrate in closed form with the Bessel function I0, and the spectrum is radial
+//  - a partial range of w0, and F0 for the radial spectrum, is integrated adaptively to the tolerance
+//the cross term does not depend on w0 and its F0 average is a constant
+//the spectrum is symmetric under f -> -f, render() evaluates half of the image (an eighth when it is radial) and mirrors it
+
+class Spectrum_engine {
+
+    public:
+
+        Spectrum_engine (float K, float a, float F0_min, float F0_max, float w0_min, float w0_max, float impulse_density, float tolerance=1e-3f)
+        :  m_a(a), m_F0_min(F0_min), m_F0_max(F0_max), m_w0_min(w0_min), m_w0_max(w0_max), m_tolerance(tolerance)
+        {
+            double const two_pi = 6.283185307179586;
+
+            m_c = float(two_pi/pow(double(a),2));
+            m_prefactor = float(double(impulse_density)/3.0 * pow(double(K)/(2.0*pow(double(a),2)), 2));
+
+            //same thresholds as Noise::power_spectrum
+            m_constant_frequency = (F0_max - F0_min <= 1e-2f);
+            m_constant_orientation = (w0_max - w0_min <= 1e-2f);
+
+            //a half turn already covers every direction since the spectrum is symmetric under f -> -f
+            float range = w0_max - w0_min;
+            m_radial = !m_constant_orientation && (fabs(range - float(two_pi)) < 1e-3f || fabs(range - float(two_pi)/2.f) < 1e-3f);
+
+            //average of exp(-c*F0^2) over F0, for the cross term
+            double sqrt_c = sqrt(double(m_c));
+            if (m_constant_frequency) {
+                m_cross_average = float(exp(-double(m_c)*pow(double(F0_min),2)));
+            }
+            else {
+                m_cross_average = float(0.5*sqrt(pi_double()/double(m_c))*erf_difference(sqrt_c*F0_max, sqrt_c*F0_min)/double(F0_max - F0_min));
+            }
+
+            m_cos = cos(w0_min);
+            m_sin = sin(w0_min);
+        }
+
+
+        bool is_radial () const {
+            return m_radial;
+        }
+
+
+        float evaluate (float fx, float fy) const {
+
+            float r2 = fx*fx + fy*fy;
+            float cross = 2.f*exp(-m_c*r2)*m_cross_average;
+
+            if (m_radial) {
+                return m_prefactor*(radial_term(sqrt(r2)) + cross);
+            }
+
+            float sum;
+            if (m_constant_orientation) {
+                sum = orientation_term(fx, fy, m_cos, m_sin);
+            }
+            else {
+                Adaptive_quadrature quadrature(m_tolerance);
+                sum = float(quadrature.integrate([&](double w0) {
+                    return orientation_term(fx, fy, float(cos(w0)), float(sin(w0)));
+                }, m_w0_min, m_w0_max, bandwidth_pieces((m_w0_max - m_w0_min)*m_F0_max))/double(m_w0_max - m_w0_min));
+            }
+
+            return m_prefactor*(sum + cross);
+
+        }
+
+
+        //frequency of the column (or row) x of the spectrum image
+        static float pixel_frequency (unsigned x, unsigned resolution, float extent) {
+            return (float(x) + 0.5f - float(resolution)/2.f)*2.f*extent/float(resolution);
+        }
+
+        //pixel whose value render() copies to (x,y): (x,y) itself in the lower half and in the right half of the middle row, its opposite otherwise
+        static void evaluated_pixel (unsigned& x, unsigned& y, unsigned resolution) {
+            unsigned last = resolution - 1;
+            if (y > last - y || (y == last - y && x < last - x)) {
+                x = last - x;
+                y = last - y;
+            }
+        }
+
+        //value of the pixel (x,y) of the image of render()
+        float evaluate_pixel (unsigned x, unsigned y, unsigned resolution, float extent) const {
+            evaluated_pixel(x, y, resolution);
+            return evaluate(pixel_frequency(x, resolution, extent), pixel_frequency(y, resolution, extent));
+        }
+
+
+        //out[y*resolution + x] = spectrum at f = (x + 0.5 - resolution/2, y + 0.5 - resolution/2)*2*extent/resolution
+        //the frequencies of the pixels x and resolution-1-x are opposite, so the symmetric half (or eighth) is copied
+        void render (unsigned resolution, float extent, float* out, thread_pool& pool) const {
+
+            unsigned half = (resolution + 1)/2;
+            auto frequency = [&](unsigned x) {
+                return pixel_frequency(x, resolution, extent);
+            };
+            auto mirror = [&](unsigned x) {
+                return min(x, resolution - 1 - x);
+            };
+
+            if (m_radial) {
+
+                //value of the pixels at distances (i,j) of the border, i >= j, in the lower left quadrant
+                vector<float> octant(half*half);
+                pool.run(half, [&](size_t i) {
+                    for (unsigned j=0 ; j<=i ; j++) {
+                        octant[i*half + j] = evaluate(frequency(unsigned(i)), frequency(j));
+                    }
+                });
+
+                pool.run(resolution, [&](size_t y) {
+                    unsigned j = mirror(unsigned(y));
+                    for (unsigned x=0 ; x<resolution ; x++) {
+                        unsigned i = mirror(x);
+                        out[y*resolution + x] = octant[max(i,j)*half + min(i,j)];
+                    }
+                });
+
+            }
+
+            else {
+
+                pool.run(half, [&](size_t y) {
+                    float fy = frequency(unsigned(y));
+                    for (unsigned x=0 ; x<resolution ; x++) {
+                        float value = evaluate(frequency(x), fy);
+                        out[y*resolution + x] = value;
+                        out[(resolution - 1 - y)*resolution + (resolution - 1 - x)] = value;
+                    }
+                });
+
+            }
+
+        }
+
+
+    private:
+
+        static double pi_double () {
+            return 3.141592653589793;
+        }
+
+
+        //the integrands are gaussians of width a, see Noise::bandwidth_pieces
+        unsigned bandwidth_pieces (float length) const {
+            return min(64u, max(1u, unsigned(ceil(length/(3.f*m_a)))));
+        }
+
+
+        //exp(-c|f-mu|^2) + exp(-c|f+mu|^2) for the orientation (cos_w0,sin_w0), averaged over F0
+        float orientation_term (float fx, float fy, float cos_w0, float sin_w0) const {
+
+            float f_parallel = fx*cos_w0 + fy*sin_w0;
+            float f_orthogonal = -fx*sin_w0 + fy*cos_w0;
+
+            if (m_constant_frequency) {
+                return exp(-m_c*(pow(f_parallel - m_F0_min,2) + f_orthogonal*f_orthogonal)) + exp(-m_c*(pow(f_parallel + m_F0_min,2) + f_orthogonal*f_orthogonal));
+            }
+            return exp(-m_c*f_orthogonal*f_orthogonal)*(frequency_average(f_parallel) + frequency_average(-f_parallel));
+
+        }
+
+
+        //erf(b) - erf(a) for b >= a, with erfc in the tails where both erf are close to 1 (or -1) and their difference cancels
+        template <typename T>
+        static T erf_difference (T b, T a) {
+            if (a > T(0)) {
+                return erfc(a) - erfc(b);
+            }
+            if (b < T(0)) {
+                return erfc(-b) - erfc(-a);
+            }
+            return erf(b) - erf(a);
+        }
+
+
+        //average over F0 of exp(-c*(p-F0)^2)
+        float frequency_average (float p) const {
+            float sqrt_c = sqrt(m_c);
+            return 0.5f*sqrt(float(pi_double())/m_c)*erf_difference(sqrt_c*(m_F0_max - p), sqrt_c*(m_F0_min - p))/(m_F0_max - m_F0_min);
+        }
+
+
+        //average over w0 of exp(-c|f-mu|^2) + exp(-c|f+mu|^2) for |f| = r, then over F0
+        float radial_term (float r) const {
+
+            if (m_constant_frequency) {
+                return 2.f*orientation_average(r, m_F0_min);
+            }
+
+            Adaptive_quadrature quadrature(m_tolerance);
+            return float(quadrature.integrate([&](double F0) {
+                return 2.f*orientation_average(r, float(F0));
+            }, m_F0_min, m_F0_max, bandwidth_pieces(m_F0_max - m_F0_min))/double(m_F0_max - m_F0_min));
+
+        }
+
+
+        //average over a turn of exp(-c|f-mu|^2) = exp(-c(r^2+F0^2))*I0(2c*r*F0) = exp(-c(r-F0)^2)*I0(z)*exp(-z)
+        float orientation_average (float r, float F0) const {
+            return exp(-m_c*pow(r - F0,2))*scaled_bessel_i0(2.f*m_c*r*F0);
+        }
+
+
+        //I0(x)*exp(-x) for x >= 0, polynomial approximations of Abramowitz and Stegun 9.8.1 and 9.8.2 (relative error < 2e-7)
+        static float scaled_bessel_i0 (float x) {
+
+            if (x <= 3.75f) {
+                float t = (x/3.75f)*(x/3.75f);
+                float i0 = 1.f + t*(3.5156229f + t*(3.0899424f + t*(1.2067492f + t*(0.2659732f + t*(0.0360768f + t*0.0045813f)))));
+                return i0*exp(-x);
+            }
+
+            float t = 3.75f/x;
+            float p = 0.39894228f + t*(0.01328592f + t*(0.00225319f + t*(-0.00157565f + t*(0.00916281f + t*(-0.02057706f + t*(0.02635537f + t*(-0.01647633f + t*0.00392377f)))))));
+            return p/sqrt(x);
+
+        }
+
+
+        float m_a;
+        float m_F0_min;
+        float m_F0_max;
+        float m_w0_min;
+        float m_w0_max;
+        float m_tolerance;
+        float m_c;
+        float m_prefactor;
+        float m_cross_average;
+        bool m_constant_frequency;
+        bool m_constant_orientation;
+        bool m_radial;
+        float m_cos;
+        float m_sin;
+
+};
@@ -0,0 +1,99 @@
+#pragma once
+
+#include <cmath>
+#include <cstdint>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+#include "Spectrum_engine.h"
+
+using namespace std;
+
+//values of the pixels of a spectrum image of the given resolution and extent (the grid of Spectrum_engine::render), keyed by the pixel
+//the pixels of opposite frequencies share their key and the value of the pixel render() evaluates (Spectrum_engine::evaluated_pixel),
+//so that it does not depend on the order of the requests
+//the memo is split into shards protected by their own mutex, as the impulse cache, so that several threads can share it
+
+class Spectrum_memo {
+
+    public:
+
+        struct Statistics {
+            size_t hits = 0;
+            size_t misses = 0;
+            size_t entries = 0;
+        };
+
+
+        Spectrum_memo (Spectrum_engine const& engine, unsigned resolution, float extent, unsigned number_of_shards=16)
+        :  m_engine(engine), m_resolution(resolution), m_extent(extent), m_shards(number_of_shards == 0 ? 1 : number_of_shards)
+        {}
+
+
+        //spectrum of the pixel (x,y), evaluated outside of the lock the first time the pixel or its opposite is requested
+        float value (unsigned x, unsigned y) {
+
+            Spectrum_engine::evaluated_pixel(x, y, m_resolution);
+            uint64_t k = uint64_t(y)*m_resolution + x;
+            Shard& shard = shard_of(k);
+
+            {
+                lock_guard<mutex> lock(shard.access);
+                auto it = shard.values.find(k);
+                if (it != shard.values.end()) {
+                    shard.hits++;
+                    return it->second;
+                }
+                shard.misses++;
+            }
+
+            float value = m_engine.evaluate_pixel(x, y, m_resolution, m_extent);
+
+            lock_guard<mutex> lock(shard.access);
+            shard.values.emplace(k, value); //another thread may have stored the same value meanwhile
+            return value;
+
+        }
+
+
+        bool covers (unsigned resolution, float extent) const {
+            return resolution == m_resolution && extent == m_extent;
+        }
+
+
+        Statistics statistics () {
+
+            Statistics statistics;
+
+            for (Shard& shard : m_shards) {
+                lock_guard<mutex> lock(shard.access);
+                statistics.hits += shard.hits;
+                statistics.misses += shard.misses;
+                statistics.entries += shard.values.size();
+            }
+
+            return statistics;
+
+        }
+
+
+    private:
+
+        struct Shard {
+            mutex access;
+            unordered_map<uint64_t, float> values;
+            size_t hits = 0;
+            size_t misses = 0;
+        };
+
+        Shard& shard_of (uint64_t k) {
+            uint64_t h = k*0x9E3779B97F4A7C15ull;
+            return m_shards[(h >> 40) % m_shards.size()];
+        }
+
+        Spectrum_engine m_engine;
+        unsigned m_resolution;
+        float m_extent;
+        vector<Shard> m_shards;
+
+};
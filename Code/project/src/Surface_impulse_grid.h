@@ -0,0 +1,121 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+#include "vcl/vcl.hpp"
+
+using namespace std;
+using namespace vcl;
+
+//impulses of a 3D cell before their projection on the tangent plane
+
+struct Surface_impulses {
+
+    vector<float> x;
+    vector<float> y;
+    vector<float> z;
+    vector<float> w0;
+
+    void resize (size_t n) {
+        x.resize(n);
+        y.resize(n);
+        z.resize(n);
+        w0.resize(n);
+    }
+
+};
+
+
+//sparse grid of the impulses of the 3D cells visited by a mesh
+//the cells are generated once each, in parallel, then only read: the vertices sharing a cell share its impulses without locking
+
+class Surface_impulse_grid {
+
+    public:
+
+        //3D morton code of the cell, 21 bits per coordinate biased to be positive
+        static uint64_t key (int i, int j, int k) {
+            return spread(uint32_t(i + (1 << 20))) | (spread(uint32_t(j + (1 << 20))) << 1) | (spread(uint32_t(k + (1 << 20))) << 2);
+        }
+
+        static void cell_of_key (uint64_t key, int& i, int& j, int& k) {
+            i = int(compact(key)) - (1 << 20);
+            j = int(compact(key >> 1)) - (1 << 20);
+            k = int(compact(key >> 2)) - (1 << 20);
+        }
+
+
+        //neighbouring cells have close morton codes, the 64 bits are mixed (murmur3 finalizer) into a 32 bits seed
+        static unsigned mix (uint64_t key) {
+            key ^= key >> 33;
+            key *= 0xff51afd7ed558ccdull;
+            key ^= key >> 33;
+            key *= 0xc4ceb9fe1a85ec53ull;
+            key ^= key >> 33;
+            return unsigned(key);
+        }
+
+
+        //generate(i, j, k, Surface_impulses&) draws the impulses of the cell (i,j,k), keys may hold duplicates
+        template <typename Generate>
+        void build (vector<uint64_t> keys, Generate const& generate, thread_pool& pool) {
+
+            sort(keys.begin(), keys.end());
+            keys.erase(unique(keys.begin(), keys.end()), keys.end());
+
+            m_cells.assign(keys.size(), Surface_impulses());
+            pool.run(keys.size(), [&](size_t c) {
+                int i, j, k;
+                cell_of_key(keys[c], i, j, k);
+                generate(i, j, k, m_cells[c]);
+            });
+
+            m_index.clear();
+            m_index.reserve(keys.size());
+            for (size_t c=0 ; c<keys.size() ; c++) {
+                m_index[keys[c]] = unsigned(c);
+            }
+
+        }
+
+
+        //the cell has to be one of the keys given to build
+        Surface_impulses const& impulses (int i, int j, int k) const {
+            return m_cells[m_index.at(key(i, j, k))];
+        }
+
+
+        size_t number_of_cells () const {
+            return m_cells.size();
+        }
+
+
+    private:
+
+        //inserts two zero bits between the 21 low bits of x
+        static uint64_t spread (uint32_t x) {
+            uint64_t v = x & 0x1fffff;
+            v = (v | (v << 32)) & 0x1f00000000ffffull;
+            v = (v | (v << 16)) & 0x1f0000ff0000ffull;
+            v = (v | (v << 8)) & 0x100f00f00f00f00full;
+            v = (v | (v << 4)) & 0x10c30c30c30c30c3ull;
+            v = (v | (v << 2)) & 0x1249249249249249ull;
+            return v;
+        }
+
+        static uint32_t compact (uint64_t v) {
+            v &= 0x1249249249249249ull;
+            v = (v | (v >> 2)) & 0x10c30c30c30c30c3ull;
+            v = (v | (v >> 4)) & 0x100f00f00f00f00full;
+            v = (v | (v >> 8)) & 0x1f0000ff0000ffull;
+            v = (v | (v >> 16)) & 0x1f00000000ffffull;
+            v = (v | (v >> 32)) & 0x1fffff;
+            return uint32_t(v);
+        }
+
+        vector<Surface_impulses> m_cells;
+        unordered_map<uint64_t, unsigned> m_index;
+
+};
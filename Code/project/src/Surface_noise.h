@@ -5,100 +5,267 @@
 #include <cmath>
 #include "vcl/vcl.hpp"
 #include "Pseudo_random_number_generator.h"
+#include "Gabor_kernel.h"
+#include "Noise_counters.h"
+#include "Surface_impulse_grid.h"
 
 using namespace std;
 using namespace vcl;
 
 //only isotropic noise
+//Generator is Pseudo_random_number_generator (the original stream) or Counter_based_random_number_generator
 
-class Surface_noise {
+template <typename Generator>
+class Basic_surface_noise {
 
     public:
 
-        Surface_noise (float K, float a, float F0, float number_of_impulses_per_kernel, unsigned random_offset, bool is_periodic, unsigned period=256.f)
+        Basic_surface_noise (float K, float a, float F0, float number_of_impulses_per_kernel, unsigned random_offset, bool is_periodic, unsigned period=256.f)
         :  m_K(K), m_a(a), m_F0(F0), m_random_offset(random_offset), m_is_periodic(is_periodic), m_period(period)
         {
             m_kernel_radius = 1.f/m_a;
             m_impulse_density = number_of_impulses_per_kernel/(pi*pow(m_kernel_radius,2));
+            m_accuracy = Kernel_accuracy::exact;
         }
 
 
-        float intensity (float x, float y, float z, vec3 n) {
-
-            x = x/m_kernel_radius ;
-            y = y/m_kernel_radius ;
-            z = z/m_kernel_radius ;
+        //exact keeps the libm kernel, accurate and fast use the vectorized approximations of Gabor_kernel.h
+        void set_kernel_accuracy (Kernel_accuracy accuracy) {
+            m_accuracy = accuracy;
+        }
 
 
-            float frac_x = x-floor(x);
-            float frac_y = y-floor(y);
-            float frac_z = y-floor(y);
+        float intensity (float x, float y, float z, vec3 n) const {
+            return sum_of_cells(x, y, z, [&](int i, int j, int k, float cell_x, float cell_y, float cell_z) {
+                return cell_noise(i, j, k, cell_x, cell_y, cell_z, n);
+            });
+        }
 
-            float noise_intensity = 0.f;
 
-            for (int i=-1 ; i<=1 ; i++) {
-                for (int j=-1 ; j<=1 ; j++) {
-                    for (int k=-1 ; k<=1 ; k++) {
-                        noise_intensity += cell_noise(floor(x) + i, floor(y) + j, floor(z) + k, frac_x - i, frac_y - j, frac_z - k, n);
-                    }
-                }
-            }
+        //intensity of every vertex of the mesh, at its position multiplied by position_scale, with its normal
+        //the cells around the vertices are generated once each in a grid shared by all the vertices,
+        //the tangent frame of a vertex in each of its 27 cells is computed once instead of twice per impulse,
+        //the impulses are then projected with a 2x3 matrix; vertices are evaluated in parallel
+        void evaluate_mesh (mesh const& shape, buffer<float>& out, thread_pool& pool, float position_scale=1.f) const {
 
-            return noise_intensity;
+            size_t number_of_vertices = shape.position.size();
+            out.resize(number_of_vertices);
 
-        }
+            size_t block = 64;
+            size_t number_of_blocks = (number_of_vertices + block - 1)/block;
 
+            //cells visited by each block of vertices
+            vector<vector<uint64_t>> block_keys(number_of_blocks);
+            pool.run(number_of_blocks, [&](size_t b) {
+                for (size_t v=b*block ; v<min(number_of_vertices, (b+1)*block) ; v++) {
+                    vec3 p = position_scale*shape.position[v];
+                    sum_of_cells(p[0], p[1], p[2], [&](int i, int j, int k, float, float, float) {
+                        block_keys[b].push_back(Surface_impulse_grid::key(i, j, k));
+                        return 0.f;
+                    });
+                }
+                sort(block_keys[b].begin(), block_keys[b].end());
+                block_keys[b].erase(unique(block_keys[b].begin(), block_keys[b].end()), block_keys[b].end());
+            });
 
-        float cell_noise (int i, int j, int k, float x, float y, float z, vec3 n) {
+            vector<uint64_t> keys;
+            for (vector<uint64_t> const& k : block_keys) {
+                keys.insert(keys.end(), k.begin(), k.end());
+            }
+            block_keys.clear();
+
+            Surface_impulse_grid grid;
+            grid.build(move(keys), [this](int i, int j, int k, Surface_impulses& impulses) { draw_cell_impulses(i, j, k, impulses); }, pool);
+
+            pool.run(number_of_blocks, [&](size_t b) {
+                for (size_t v=b*block ; v<min(number_of_vertices, (b+1)*block) ; v++) {
+                    vec3 p = position_scale*shape.position[v];
+                    vec3 n = shape.normal[v];
+                    out[v] = sum_of_cells(p[0], p[1], p[2], [&](int i, int j, int k, float cell_x, float cell_y, float cell_z) {
+                        return framed_cell_noise(grid.impulses(i, j, k), cell_x, cell_y, cell_z, n);
+                    });
+                }
+            });
 
-            unsigned seed;
+        }
 
-            if (m_is_periodic) { seed = ((unsigned)j % m_period)*m_period + ((unsigned)i % m_period) + m_random_offset; } //periodic noise
-            else { seed = morton(i, j) + m_random_offset; } // nonperiodic noise
 
-            if (seed == 0) {seed = 1;}
+        float cell_noise (int i, int j, int k, float x, float y, float z, vec3 n) const {
 
-            Pseudo_random_number_generator prng(seed);
+            Surface_impulses impulses;
+            draw_cell_impulses(i, j, k, impulses);
+            unsigned number_of_impulses = unsigned(impulses.x.size());
 
-            float number_of_impulses_per_cell = m_impulse_density*pow(m_kernel_radius,3);
-            unsigned number_of_impulses = prng.poisson(number_of_impulses_per_cell);
+            if (m_accuracy != Kernel_accuracy::exact) {
+                return projected_cell_noise(impulses, x, y, z, n);
+            }
 
             float noise = 0.f;
+            NOISE_COUNTERS_ONLY(size_t kernel_evaluations = 0;)
 
             for (unsigned i=0 ; i<number_of_impulses ; i++) {
 
-              float xi = prng.uniform_0_1();
-              float yi = prng.uniform_0_1();
-              float zi = prng.uniform_0_1();
-              vec3 pi = {xi,yi,zi};
+              vec3 pi = {impulses.x[i],impulses.y[i],impulses.z[i]};
               vec3 p = {x,y,z};
               float wi = 1.f - norm(pi-projection_3D(pi,p,n));
 
-              float w0i = prng.uniform(0, 2.f*3.14f);
+              float w0i = impulses.w0[i];
 
               vec2 pibis = projection_2D(pi,p,n);
               vec2 pbis = projection_2D(p,p,n);
 
               if (norm(pbis-pibis) < 1.f) {
+                NOISE_COUNTERS_ONLY(kernel_evaluations++;)
                 noise += wi*gabor(m_K, m_a, m_F0, w0i, m_kernel_radius*(pbis-pibis)[0], m_kernel_radius*(pbis-pibis)[1]);
               }
 
             }
 
+            NOISE_COUNTERS_ONLY(Noise_counters::count_cell(number_of_impulses, kernel_evaluations);)
             return noise;
 
         }
 
+        //same as cell_noise for the impulses of the cell
+        float framed_cell_noise (Surface_impulses const& impulses, float x, float y, float z, vec3 n) const {
+
+            vec3 p = {x,y,z};
+            vec3 u1, u2;
+            tangent_frame(p, n, u1, u2);
+            float n_squared_norm = dot(n,n);
+            float n_norm = norm(n);
+
+            if (m_accuracy != Kernel_accuracy::exact) {
+                Impulse_list projected;
+                projected.reserve(impulses.x.size());
+                for (size_t i=0 ; i<impulses.x.size() ; i++) {
+                    vec3 d = p - vec3(impulses.x[i], impulses.y[i], impulses.z[i]);
+                    float alpha = dot(d,n)/n_squared_norm;
+                    vec3 tangent = d - alpha*n;
+                    projected.push_back(-dot(tangent,u1), -dot(tangent,u2), 1.f - fabs(alpha)*n_norm, m_F0, impulses.w0[i]);
+                }
+                projected.compute_harmonics();
+                return gabor_kernel_sum(m_accuracy, m_K, m_a, m_kernel_radius, 0.f, 0.f, projected);
+            }
+
+            float noise = 0.f;
+            NOISE_COUNTERS_ONLY(size_t kernel_evaluations = 0;)
+
+            for (size_t i=0 ; i<impulses.x.size() ; i++) {
+
+                //component of p - impulse in the tangent plane, in the frame (u1,u2)
+                vec3 d = p - vec3(impulses.x[i], impulses.y[i], impulses.z[i]);
+                float alpha = dot(d,n)/n_squared_norm;
+                vec3 tangent = d - alpha*n;
+                float offset_x = dot(tangent,u1);
+                float offset_y = dot(tangent,u2);
+
+                if (offset_x*offset_x + offset_y*offset_y < 1.f) {
+                    NOISE_COUNTERS_ONLY(kernel_evaluations++;)
+                    noise += (1.f - fabs(alpha)*n_norm)*gabor(m_K, m_a, m_F0, impulses.w0[i], m_kernel_radius*offset_x, m_kernel_radius*offset_y);
+                }
+
+            }
+
+            NOISE_COUNTERS_ONLY(Noise_counters::count_cell(impulses.x.size(), kernel_evaluations);)
+            return noise;
+
+        }
+
+        //same impulses as cell_noise, projected once on the tangent plane then summed by the vectorized kernel
+        float projected_cell_noise (Surface_impulses const& drawn, float x, float y, float z, vec3 n) const {
+
+            vec3 p = {x,y,z};
+            vec2 pbis = projection_2D(p,p,n);
+
+            Impulse_list impulses;
+            impulses.reserve(drawn.x.size());
+
+            for (size_t i=0 ; i<drawn.x.size() ; i++) {
+
+              vec3 pi = {drawn.x[i],drawn.y[i],drawn.z[i]};
+              float wi = 1.f - norm(pi-projection_3D(pi,p,n));
+
+              vec2 offset = projection_2D(pi,p,n) - pbis;
+              impulses.push_back(offset[0], offset[1], wi, m_F0, drawn.w0[i]);
+
+            }
+
+            impulses.compute_harmonics();
+            return gabor_kernel_sum(m_accuracy, m_K, m_a, m_kernel_radius, 0.f, 0.f, impulses);
+
+        }
+
+        unsigned cell_seed (int i, int j, int k) const {
+
+            unsigned seed;
+
+            if (m_is_periodic) { seed = (((unsigned)k % m_period)*m_period + ((unsigned)j % m_period))*m_period + ((unsigned)i % m_period) + m_random_offset; } //periodic noise
+            else { seed = Surface_impulse_grid::mix(Surface_impulse_grid::key(i, j, k)) + m_random_offset; } // nonperiodic noise
+
+            if (seed == 0) {seed = 1;}
+            return seed;
+
+        }
+
+        //impulses of the cell (i,j,k)
+        void draw_cell_impulses (int i, int j, int k, Surface_impulses& impulses) const {
+
+            Generator prng(cell_seed(i, j, k));
+
+            float number_of_impulses_per_cell = m_impulse_density*pow(m_kernel_radius,3);
+            unsigned number_of_impulses = prng.poisson(number_of_impulses_per_cell);
+            NOISE_COUNTERS_ONLY(Noise_counters::count_impulses(number_of_impulses);)
+
+            draw_impulses(prng, number_of_impulses, impulses);
+
+        }
+
+        //the sequential generator draws x,y,z,w0 impulse after impulse
+        void draw_impulses (Pseudo_random_number_generator& prng, unsigned number_of_impulses, Surface_impulses& impulses) const {
+
+            impulses.resize(number_of_impulses);
+
+            for (unsigned i=0 ; i<number_of_impulses ; i++) {
+              impulses.x[i] = prng.uniform_0_1();
+              impulses.y[i] = prng.uniform_0_1();
+              impulses.z[i] = prng.uniform_0_1();
+              impulses.w0[i] = prng.uniform(0, 2.f*3.14f);
+            }
+
+        }
+
+        //the counter-based generator draws each parameter of all the impulses in one batch
+        void draw_impulses (Counter_based_random_number_generator& prng, unsigned number_of_impulses, Surface_impulses& impulses) const {
+
+            impulses.resize(number_of_impulses);
+
+            prng.uniform_batch(1, number_of_impulses, 0.f, 1.f, impulses.x.data());
+            prng.uniform_batch(2, number_of_impulses, 0.f, 1.f, impulses.y.data());
+            prng.uniform_batch(3, number_of_impulses, 0.f, 1.f, impulses.z.data());
+            prng.uniform_batch(4, number_of_impulses, 0.f, 2.f*3.14f, impulses.w0.data());
+
+        }
+
         //Projects point M on the plane define by point p and vector n
-        vec3 projection_3D (vec3 M, vec3 p, vec3 n){
+        vec3 projection_3D (vec3 M, vec3 p, vec3 n) const {
             float alpha = dot(p-M,n)/dot(n,n);
             return M + alpha*n;
         }
 
-        vec2 projection_2D (vec3 M, vec3 p, vec3 n){
+        vec2 projection_2D (vec3 M, vec3 p, vec3 n) const {
 
             vec3 p_orth = projection_3D(M,p,n);
-            vec3 u1;
+            vec3 u1, u2;
+            tangent_frame(p, n, u1, u2);
+
+            return dot(p_orth,u1)*vec2(1,0) + dot(p_orth,u2)*vec2(0,1);
+
+        }
+
+        //basis (u1,u2) of the coordinates of projection_2D on the plane defined by point p and vector n
+        void tangent_frame (vec3 p, vec3 n, vec3& u1, vec3& u2) const {
+
             if (fabs(n[0]) > pow(10,-2)) {
                 u1 = {(dot(p,n)-n[1])/n[0],1,0};
                 if (norm(u1-p)<pow(10,-2)){
@@ -119,34 +286,50 @@ class Surface_noise {
             }
 
             u1 = (u1)/norm(u1) ;
-            vec3 u2 = cross(n,u1);
-
-            return dot(p_orth,u1)*vec2(1,0) + dot(p_orth,u2)*vec2(0,1);
+            u2 = cross(n,u1);
 
         }
 
-        unsigned morton (unsigned x, unsigned y) {
-            unsigned z = 0;
-            for (unsigned i = 0; i < (sizeof(unsigned) * CHAR_BIT); ++i) {
-                z |= ((x & (1 << i)) << i) | ((y & (1 << i)) << (i + 1));
+        //sum of cell_noise(i, j, k, x, y, z) over the 27 cells around the point, x, y, z relative to the cell
+        template <typename Cell_noise>
+        float sum_of_cells (float x, float y, float z, Cell_noise const& cell_noise) const {
+
+            x = x/m_kernel_radius ;
+            y = y/m_kernel_radius ;
+            z = z/m_kernel_radius ;
+
+
+            float frac_x = x-floor(x);
+            float frac_y = y-floor(y);
+            float frac_z = z-floor(z);
+
+            float noise_intensity = 0.f;
+
+            for (int i=-1 ; i<=1 ; i++) {
+                for (int j=-1 ; j<=1 ; j++) {
+                    for (int k=-1 ; k<=1 ; k++) {
+                        noise_intensity += cell_noise(floor(x) + i, floor(y) + j, floor(z) + k, frac_x - i, frac_y - j, frac_z - k);
+                    }
+                }
             }
-            return z;
-        }
 
+            return noise_intensity;
+
+        }
 
-        float gabor (float K, float a, float F0, float w0, float x, float y) {
+        float gabor (float K, float a, float F0, float w0, float x, float y) const {
             float gaussian = K*exp( -pi*pow(a,2)*(pow(x,2) + pow(y,2)) );
             float harmonic = cos( 2.f*pi*F0*(x*cos(w0) + y*sin(w0)) );
             return gaussian*harmonic;
         }
 
 
-        float variance() {
+        float variance() const {
             return ((m_impulse_density*pow(m_K,2))/(12.f*pow(m_a,2))) * (1.f + exp(-2.f*pi*pow(m_F0,2)/pow(m_a,2)));
         }
 
 
-        float gabor_fourier_transform (float K, float a, float F0, float w0, float fx, float fy) {
+        float gabor_fourier_transform (float K, float a, float F0, float w0, float fx, float fy) const {
             return ( exp( -(pow(fx-F0*cos(w0),2) + pow(fy-F0*sin(w0),2))*pi/pow(a,2) ) + exp( -(pow(fx+F0*cos(w0),2) + pow(fy+F0*sin(w0),2))*pi/pow(a,2) ) )*K/(2.f*pow(a,2));
         }
 
@@ -161,5 +344,8 @@ class Surface_noise {
         unsigned m_random_offset;
         bool m_is_periodic;
         unsigned m_period;
+        Kernel_accuracy m_accuracy;
 
 };
+
+typedef Basic_surface_noise<Pseudo_random_number_generator> Surface_noise;
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <algorithm>
+#include "vcl/vcl.hpp"
+#include "Cancellation_token.h"
+
+using namespace std;
+using namespace vcl;
+
+//splits a width x height image into square tiles rendered in parallel by the work-stealing thread pool
+//each tile is handed to render_tile(x_begin, y_begin, tile_width, tile_height), which must only write the pixels of its tile
+//the pixels do not depend on the tiling, so the output is identical to the serial rendering whatever the number of threads
+//once the cancellation token, if any, is cancelled the remaining tiles are skipped
+
+class Tile_renderer {
+
+    public:
+
+        Tile_renderer (thread_pool& pool, unsigned tile_size=64)
+        :  m_pool(pool), m_tile_size(tile_size)
+        {}
+
+
+        template <typename Render_tile>
+        void render (unsigned width, unsigned height, Render_tile const& render_tile, Cancellation_token const* cancellation = nullptr) const {
+
+            unsigned number_of_tiles_x = (width + m_tile_size - 1)/m_tile_size;
+            unsigned number_of_tiles_y = (height + m_tile_size - 1)/m_tile_size;
+
+            m_pool.run(number_of_tiles_x*number_of_tiles_y, [&](size_t k) {
+                if (cancellation && cancellation->cancelled()) {return;}
+                unsigned x_begin = unsigned(k % number_of_tiles_x)*m_tile_size;
+                unsigned y_begin = unsigned(k / number_of_tiles_x)*m_tile_size;
+                render_tile(x_begin, y_begin, min(m_tile_size, width - x_begin), min(m_tile_size, height - y_begin));
+            });
+
+        }
+
+
+        unsigned tile_size () const {
+            return m_tile_size;
+        }
+
+
+    private:
+
+        thread_pool& m_pool;
+        unsigned m_tile_size;
+
+};
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <vector>
+
+using namespace std;
+
+//stages of the update of the 2D noise surface, in the order they are run
+enum class Update_stage { intensity, height, colour, normals, upload, count };
+
+
+//dependency graph of the update stages
+//invalidating a stage also invalidates every stage depending on it, directly or not,
+//so that an update only reruns the stages invalidated by the widgets that changed
+
+class Update_graph {
+
+    public:
+
+        Update_graph ()
+        :  m_dependents(size_t(Update_stage::count)), m_dirty(size_t(Update_stage::count), true)
+        {}
+
+
+        //dependent has to be rerun whenever stage is
+        void add_dependency (Update_stage stage, Update_stage dependent) {
+            m_dependents[size_t(stage)].push_back(dependent);
+        }
+
+
+        void invalidate (Update_stage stage) {
+            m_dirty[size_t(stage)] = true;
+            invalidate_dependents(stage);
+        }
+
+        //the stages depending on stage, which itself keeps its state
+        void invalidate_dependents (Update_stage stage) {
+            for (Update_stage dependent : m_dependents[size_t(stage)]) {
+                invalidate(dependent);
+            }
+        }
+
+
+        bool is_dirty (Update_stage stage) const {
+            return m_dirty[size_t(stage)];
+        }
+
+
+        //the stage has been rerun
+        void validate (Update_stage stage) {
+            m_dirty[size_t(stage)] = false;
+        }
+
+
+    private:
+
+        vector<vector<Update_stage>> m_dependents;
+        vector<bool> m_dirty;
+
+};
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+#include "vcl/vcl.hpp"
+#include "Vec3.h"
+
+using namespace std;
+using namespace vcl;
+
+//per vertex loops shared by update_2D_noise, update_surface_noise and vertex_loop_benchmark
+//intensity(k) is the noise intensity of the vertex k, scale the intensity mapped to the whole color scale (6 standard deviations)
+//the vertices of a range of parallel_for only write their own position or colour
+
+
+//linear interpolation of the color scale for t in [0,1]
+inline Vec3f find_color (vector<Vec3f> const& color_scale, float t) {
+
+    int n = color_scale.size();
+    int i = floor(t*float(n-1));
+
+    if (i==n-1) {
+        return color_scale[n-1];
+    }
+
+    else {
+        float tbis = (t-float(i)/float(n-1))/(float(i+1)/float(n-1)-float(i)/float(n-1));
+        return (1.f-tbis)*color_scale[i] + tbis*color_scale[i+1];
+    }
+}
+
+
+//color of the vertex k for the intensity centered between 0 and 1, a scale of a single color paints every vertex with it
+template <typename Intensity>
+void color_vertices (thread_pool& pool, size_t number_of_vertices, size_t grain_size, Intensity const& intensity, float scale, vector<Vec3f> const& color_scale, buffer<vec3>& color) {
+    parallel_for(pool, number_of_vertices, grain_size, [&](size_t begin, size_t end) {
+        for (size_t k=begin ; k<end ; k++) {
+            float t = min(max(0.5f + intensity(k)/(scale), 0.f), 1.f);
+            Vec3f c = find_color(color_scale, t);
+            color[k] = vec3(c[0], c[1], c[2]);
+        }
+    });
+}
+
+
+//height of the vertex k
+template <typename Intensity>
+void displace_vertices (thread_pool& pool, size_t number_of_vertices, size_t grain_size, Intensity const& intensity, float amplitude, float scale, buffer<vec3>& position) {
+    parallel_for(pool, number_of_vertices, grain_size, [&](size_t begin, size_t end) {
+        for (size_t k=begin ; k<end ; k++) {
+            position[k][2] = amplitude*intensity(k)/(scale);
+        }
+    });
+}
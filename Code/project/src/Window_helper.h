@@ -45,6 +45,7 @@ bool w_customed = (!w_isotropic) && (!w_anisotropic);
 bool w_height_noise = true;
 bool w_color_scale = false;
 bool w_cylinder = true;
+bool w_live_preview = false; //updates the noise while the sliders move instead of waiting for "Apply changes"
 
 void mouse_move_callback(GLFWwindow* window, double xpos, double ypos);
 void window_size_callback(GLFWwindow* window, int width, int height);
@@ -52,6 +53,7 @@ void window_size_callback(GLFWwindow* window, int width, int height);
 void initialize_2D_data();
 void initialize_3D_data();
 void display_interface();
+void display_status(bool updating, float progress);
 void update_surface();
 
 
@@ -182,11 +184,57 @@ void display_interface()
 
         }
 
+        ImGui::Spacing();ImGui::Spacing();
+        ImGui::Checkbox("Live preview", &w_live_preview);
+
+        need_update = false;
         if (!(w_isotropic && w_anisotropic) && w_F0_min <= w_F0_max &&  w_w0_min <= w_w0_max) {
-            ImGui::Spacing();ImGui::Spacing();
-            need_update = ImGui::Button("Apply changes");
+            if (w_live_preview) {
+                need_update = true;
+            }
+            else {
+                ImGui::Spacing();ImGui::Spacing();
+                need_update = ImGui::Button("Apply changes");
+            }
+        }
+
+}
+
+
+//small overlay showing that the interface stays responsive while the noise is recomputed
+void display_status(bool updating, float progress)
+{
+        ImGui::SetNextWindowBgAlpha(0.5f);
+        ImGui::Begin("Status", NULL, ImGuiWindowFlags_AlwaysAutoResize | ImGuiWindowFlags_NoTitleBar | ImGuiWindowFlags_NoFocusOnAppearing);
+
+        ImGui::Text("%d fps (%.1f ms per frame)", user.fps_record.fps, 1000.0f/ImGui::GetIO().Framerate);
+
+#ifdef NOISE_COUNTERS
+        //work of the noise evaluation since the last reset, summed over the threads
+        Noise_counts const counts = Noise_counters::read();
+        ImGui::Text("cells visited: %llu", (unsigned long long)counts.cells_visited);
+        ImGui::Text("impulses generated: %llu", (unsigned long long)counts.impulses_generated);
+        ImGui::Text("impulses rejected: %llu", (unsigned long long)counts.impulses_rejected);
+        ImGui::Text("kernel evaluations: %llu", (unsigned long long)counts.kernel_evaluations);
+        ImGui::Text("poisson iterations: %llu", (unsigned long long)counts.poisson_iterations);
+
+        if (ImGui::Button("Save counters")) {
+            string const parameters = "K=" + str(w_K) + " a=" + str(w_a) + " F0=[" + str(w_F0_min) + "," + str(w_F0_max) + "] w0=[" + str(w_w0_min) + "," + str(w_w0_max) + "] periodic=" + str(w_is_periodic);
+            string const file_name = "../output/noise_counters.json";
+            if (Noise_counters::write_json(file_name, parameters)) {cout<<"counters written to "<<file_name<<endl;}
+            else {cout<<"cannot write "<<file_name<<endl;}
+        }
+        ImGui::SameLine();
+        if (ImGui::Button("Reset counters")) {
+            Noise_counters::reset();
+        }
+#endif
+
+        if (updating) {
+            ImGui::ProgressBar(progress, ImVec2(200,0), "updating the noise");
         }
 
+        ImGui::End();
 }
 
 